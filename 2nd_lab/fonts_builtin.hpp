@@ -0,0 +1,299 @@
+// generated by ./main --gen-builtin 1 2, do not edit
+#pragma once
+
+namespace builtin_fonts {
+
+inline constexpr const char* font1_65[] = {"  *  ", " * * ", "*****", "*   *", "*   *"};
+inline constexpr const char* font1_66[] = {"**** ", "*   *", "**** ", "*   *", "**** "};
+inline constexpr const char* font1_67[] = {" ****", "*    ", "*    ", "*    ", " ****"};
+inline constexpr const char* font1_68[] = {"**** ", "*   *", "*   *", "*   *", "**** "};
+inline constexpr const char* font1_69[] = {"*****", "*    ", "*****", "*    ", "*****"};
+inline constexpr const char* font1_70[] = {"*****", "*    ", "*****", "*    ", "*    "};
+inline constexpr const char* font1_71[] = {" ****", "*    ", "*  **", "*   *", " ****"};
+inline constexpr const char* font1_72[] = {"*   *", "*   *", "*****", "*   *", "*   *"};
+inline constexpr const char* font1_73[] = {"*****", "  *  ", "  *  ", "  *  ", "*****"};
+inline constexpr const char* font1_74[] = {"  ***", "   * ", "   * ", "*  * ", " **  "};
+inline constexpr const char* font1_75[] = {"*   *", "*  * ", "***  ", "*  * ", "*   *"};
+inline constexpr const char* font1_76[] = {"*    ", "*    ", "*    ", "*    ", "*****"};
+inline constexpr const char* font1_77[] = {"*   *", "** **", "* * *", "*   *", "*   *"};
+inline constexpr const char* font1_78[] = {"*   *", "**  *", "* * *", "*  **", "*   *"};
+inline constexpr const char* font1_79[] = {" *** ", "*   *", "*   *", "*   *", " *** "};
+inline constexpr const char* font1_80[] = {"**** ", "*   *", "**** ", "*    ", "*    "};
+inline constexpr const char* font1_81[] = {" *** ", "*   *", "*   *", "*  * ", " ** *"};
+inline constexpr const char* font1_82[] = {"**** ", "*   *", "**** ", "*  * ", "*   *"};
+inline constexpr const char* font1_83[] = {" ****", "*    ", " *** ", "    *", "**** "};
+inline constexpr const char* font1_84[] = {"*****", "  *  ", "  *  ", "  *  ", "  *  "};
+inline constexpr const char* font1_85[] = {"*   *", "*   *", "*   *", "*   *", " *** "};
+inline constexpr const char* font1_86[] = {"*   *", "*   *", "*   *", " * * ", "  *  "};
+inline constexpr const char* font1_87[] = {"*   *", "*   *", "* * *", "** **", "*   *"};
+inline constexpr const char* font1_88[] = {"*   *", " * * ", "  *  ", " * * ", "*   *"};
+inline constexpr const char* font1_89[] = {"*   *", " * * ", "  *  ", "  *  ", "  *  "};
+inline constexpr const char* font1_90[] = {"*****", "   * ", "  *  ", " *   ", "*****"};
+inline constexpr const char* font1_1025[] = {" * * ", "*****", "**** ", "*    ", "*****"};
+inline constexpr const char* font1_1040[] = {"  *  ", " * * ", "*****", "*   *", "*   *"};
+inline constexpr const char* font1_1041[] = {"*****", "*    ", "**** ", "*   *", "**** "};
+inline constexpr const char* font1_1042[] = {"**** ", "*   *", "**** ", "*   *", "**** "};
+inline constexpr const char* font1_1043[] = {"*****", "*    ", "*    ", "*    ", "*    "};
+inline constexpr const char* font1_1044[] = {" *** ", " * * ", " * * ", "*****", "*   *"};
+inline constexpr const char* font1_1045[] = {"*****", "*    ", "*****", "*    ", "*****"};
+inline constexpr const char* font1_1046[] = {"* * *", "* * *", " *** ", "* * *", "* * *"};
+inline constexpr const char* font1_1047[] = {"**** ", "    *", " *** ", "    *", "**** "};
+inline constexpr const char* font1_1048[] = {"*   *", "*  **", "* * *", "**  *", "*   *"};
+inline constexpr const char* font1_1049[] = {"  *  ", "*   *", "*  **", "* * *", "**  *"};
+inline constexpr const char* font1_1050[] = {"*   *", "*  * ", "***  ", "*  * ", "*   *"};
+inline constexpr const char* font1_1051[] = {"  ***", " *  *", " *  *", " *  *", "*   *"};
+inline constexpr const char* font1_1052[] = {"*   *", "** **", "* * *", "*   *", "*   *"};
+inline constexpr const char* font1_1053[] = {"*   *", "*   *", "*****", "*   *", "*   *"};
+inline constexpr const char* font1_1054[] = {" *** ", "*   *", "*   *", "*   *", " *** "};
+inline constexpr const char* font1_1055[] = {"*****", "*   *", "*   *", "*   *", "*   *"};
+inline constexpr const char* font1_1056[] = {"**** ", "*   *", "**** ", "*    ", "*    "};
+inline constexpr const char* font1_1057[] = {" ****", "*    ", "*    ", "*    ", " ****"};
+inline constexpr const char* font1_1058[] = {"*****", "  *  ", "  *  ", "  *  ", "  *  "};
+inline constexpr const char* font1_1059[] = {"*   *", "*   *", " ****", "    *", "**** "};
+inline constexpr const char* font1_1060[] = {" *** ", "* * *", "* * *", " *** ", "  *  "};
+inline constexpr const char* font1_1061[] = {"*   *", " * * ", "  *  ", " * * ", "*   *"};
+inline constexpr const char* font1_1062[] = {"*  * ", "*  * ", "*  * ", "*****", "    *"};
+inline constexpr const char* font1_1063[] = {"*   *", "*   *", " ****", "    *", "    *"};
+inline constexpr const char* font1_1064[] = {"* * *", "* * *", "* * *", "* * *", "*****"};
+inline constexpr const char* font1_1065[] = {"* * *", "* * *", "* * *", "*****", "    *"};
+inline constexpr const char* font1_1066[] = {"**   ", " *   ", " *** ", " *  *", " *** "};
+inline constexpr const char* font1_1067[] = {"*   *", "*   *", "*** *", "*  **", "*** *"};
+inline constexpr const char* font1_1068[] = {"*    ", "*    ", "**** ", "*   *", "**** "};
+inline constexpr const char* font1_1069[] = {"**** ", "    *", " ****", "    *", "**** "};
+inline constexpr const char* font1_1070[] = {"*  * ", "* * *", "*** *", "* * *", "*  * "};
+inline constexpr const char* font1_1071[] = {" ****", "*   *", " ****", " *  *", "*   *"};
+
+inline constexpr BuiltinGlyph font1[] = {
+	{65, 5, font1_65},
+	{66, 5, font1_66},
+	{67, 5, font1_67},
+	{68, 5, font1_68},
+	{69, 5, font1_69},
+	{70, 5, font1_70},
+	{71, 5, font1_71},
+	{72, 5, font1_72},
+	{73, 5, font1_73},
+	{74, 5, font1_74},
+	{75, 5, font1_75},
+	{76, 5, font1_76},
+	{77, 5, font1_77},
+	{78, 5, font1_78},
+	{79, 5, font1_79},
+	{80, 5, font1_80},
+	{81, 5, font1_81},
+	{82, 5, font1_82},
+	{83, 5, font1_83},
+	{84, 5, font1_84},
+	{85, 5, font1_85},
+	{86, 5, font1_86},
+	{87, 5, font1_87},
+	{88, 5, font1_88},
+	{89, 5, font1_89},
+	{90, 5, font1_90},
+	{1025, 5, font1_1025},
+	{1040, 5, font1_1040},
+	{1041, 5, font1_1041},
+	{1042, 5, font1_1042},
+	{1043, 5, font1_1043},
+	{1044, 5, font1_1044},
+	{1045, 5, font1_1045},
+	{1046, 5, font1_1046},
+	{1047, 5, font1_1047},
+	{1048, 5, font1_1048},
+	{1049, 5, font1_1049},
+	{1050, 5, font1_1050},
+	{1051, 5, font1_1051},
+	{1052, 5, font1_1052},
+	{1053, 5, font1_1053},
+	{1054, 5, font1_1054},
+	{1055, 5, font1_1055},
+	{1056, 5, font1_1056},
+	{1057, 5, font1_1057},
+	{1058, 5, font1_1058},
+	{1059, 5, font1_1059},
+	{1060, 5, font1_1060},
+	{1061, 5, font1_1061},
+	{1062, 5, font1_1062},
+	{1063, 5, font1_1063},
+	{1064, 5, font1_1064},
+	{1065, 5, font1_1065},
+	{1066, 5, font1_1066},
+	{1067, 5, font1_1067},
+	{1068, 5, font1_1068},
+	{1069, 5, font1_1069},
+	{1070, 5, font1_1070},
+	{1071, 5, font1_1071},
+};
+
+inline constexpr BuiltinKerning font1_kerning[] = {
+	{65, 84, -1},
+	{65, 86, -1},
+	{65, 87, -1},
+	{65, 89, -1},
+	{70, 65, -1},
+	{76, 84, -1},
+	{76, 86, -1},
+	{76, 89, -1},
+	{80, 65, -1},
+	{84, 65, -1},
+	{86, 65, -1},
+	{87, 65, -1},
+	{89, 65, -1},
+	{1040, 1058, -1},
+	{1040, 1059, -1},
+	{1043, 1040, -1},
+	{1044, 1040, -1},
+	{1058, 1040, -1},
+	{1059, 1040, -1},
+};
+
+inline constexpr const char* font2_65[] = {"  *  ", " * * ", "*****", "*   *", "*   *", "*   *"};
+inline constexpr const char* font2_66[] = {"**** ", "*   *", "**** ", "*   *", "*   *", "****"};
+inline constexpr const char* font2_67[] = {" ****", "*    ", "*    ", "*    ", "*", " ****"};
+inline constexpr const char* font2_68[] = {"**** ", "*   *", "*   *", "*   *", "*   *", "**** "};
+inline constexpr const char* font2_69[] = {"*****", "*    ", "*****", "*    ", "*", "*****"};
+inline constexpr const char* font2_70[] = {"*****", "*    ", "*****", "*    ", "*", "*    "};
+inline constexpr const char* font2_71[] = {" ****", "*    ", "*  **", "*   *", "*   *", " **** "};
+inline constexpr const char* font2_72[] = {"*   *", "*   *", "*****", "*   *", "*   *", "*   *"};
+inline constexpr const char* font2_73[] = {"*****", "  *  ", "  *  ", "  *  ", "  *", "*****"};
+inline constexpr const char* font2_74[] = {"  ***", "   *", "   * ", "   * ", "*  * ", " **  "};
+inline constexpr const char* font2_75[] = {"*   *", "*  * ", "***  ", "*  * ", "*   *", "*   *"};
+inline constexpr const char* font2_76[] = {"*", "*    ", "*    ", "*    ", "*    ", "*****"};
+inline constexpr const char* font2_77[] = {"*   *", "** **", "* * *", "*   *", "*   *", "*   *"};
+inline constexpr const char* font2_78[] = {"*   *", "**  *", "* * *", "*  **", "*   *", "*   *"};
+inline constexpr const char* font2_79[] = {" *** ", "*   *", "*   *", "*   *", "*   *", " *** "};
+inline constexpr const char* font2_80[] = {"**** ", "*   *", "**** ", "*    ", "*   ", "* "};
+inline constexpr const char* font2_81[] = {" *** ", "*   *", "*   *", "*   * ", "*  *", " ** *"};
+inline constexpr const char* font2_82[] = {"**** ", "*   *", "**** ", "*  * ", "*   *", "*   *"};
+inline constexpr const char* font2_83[] = {" ****", "*    ", " *** ", "    *", "    *", "****"};
+inline constexpr const char* font2_84[] = {"*****", "  *  ", "  *  ", "  *  ", "  *", "  *  "};
+inline constexpr const char* font2_85[] = {"*   *", "*   *", "*   *", "*   *", "*   *", " *** "};
+inline constexpr const char* font2_86[] = {"*   *", "*   *", "*   *", "*   *", " * * ", "  *  "};
+inline constexpr const char* font2_87[] = {"*   *", "*   *", "* * *", "** **", "*   *", "*   *"};
+inline constexpr const char* font2_88[] = {"*   *", " * * ", "  *  ", " * * ", "*   *", "*   *"};
+inline constexpr const char* font2_89[] = {"*   *", " * * ", "  *  ", "  *  ", "  *", "  *  "};
+inline constexpr const char* font2_90[] = {"*****", "   * ", "  *  ", " *   ", "*", "*****"};
+inline constexpr const char* font2_1025[] = {" * * ", "*****", "**** ", "*    ", "*    ", "*****"};
+inline constexpr const char* font2_1040[] = {"  *  ", " * * ", "*****", "*   *", "*   *", "*   *"};
+inline constexpr const char* font2_1041[] = {"*****", "*    ", "**** ", "*   *", "*   *", "**** "};
+inline constexpr const char* font2_1042[] = {"**** ", "*   *", "**** ", "*   *", "*   *", "**** "};
+inline constexpr const char* font2_1043[] = {"*****", "*    ", "*    ", "*    ", "*    ", "*    "};
+inline constexpr const char* font2_1044[] = {" *** ", " * * ", " * * ", "*****", "*****", "*   *"};
+inline constexpr const char* font2_1045[] = {"*****", "*    ", "*****", "*    ", "*    ", "*****"};
+inline constexpr const char* font2_1046[] = {"* * *", "* * *", " *** ", "* * *", "* * *", "* * *"};
+inline constexpr const char* font2_1047[] = {"**** ", "    *", " *** ", "    *", "    *", "**** "};
+inline constexpr const char* font2_1048[] = {"*   *", "*  **", "* * *", "**  *", "**  *", "*   *"};
+inline constexpr const char* font2_1049[] = {"  *  ", "*   *", "*  **", "* * *", "* * *", "**  *"};
+inline constexpr const char* font2_1050[] = {"*   *", "*  * ", "***  ", "*  * ", "*  * ", "*   *"};
+inline constexpr const char* font2_1051[] = {"  ***", " *  *", " *  *", " *  *", " *  *", "*   *"};
+inline constexpr const char* font2_1052[] = {"*   *", "** **", "* * *", "*   *", "*   *", "*   *"};
+inline constexpr const char* font2_1053[] = {"*   *", "*   *", "*****", "*   *", "*   *", "*   *"};
+inline constexpr const char* font2_1054[] = {" *** ", "*   *", "*   *", "*   *", "*   *", " *** "};
+inline constexpr const char* font2_1055[] = {"*****", "*   *", "*   *", "*   *", "*   *", "*   *"};
+inline constexpr const char* font2_1056[] = {"**** ", "*   *", "**** ", "*    ", "*    ", "*    "};
+inline constexpr const char* font2_1057[] = {" ****", "*    ", "*    ", "*    ", "*    ", " ****"};
+inline constexpr const char* font2_1058[] = {"*****", "  *  ", "  *  ", "  *  ", "  *  ", "  *  "};
+inline constexpr const char* font2_1059[] = {"*   *", "*   *", " ****", "    *", "    *", "**** "};
+inline constexpr const char* font2_1060[] = {" *** ", "* * *", "* * *", " *** ", " *** ", "  *  "};
+inline constexpr const char* font2_1061[] = {"*   *", " * * ", "  *  ", " * * ", " * * ", "*   *"};
+inline constexpr const char* font2_1062[] = {"*  * ", "*  * ", "*  * ", "*****", "*****", "    *"};
+inline constexpr const char* font2_1063[] = {"*   *", "*   *", " ****", "    *", "    *", "    *"};
+inline constexpr const char* font2_1064[] = {"* * *", "* * *", "* * *", "* * *", "* * *", "*****"};
+inline constexpr const char* font2_1065[] = {"* * *", "* * *", "* * *", "*****", "*****", "    *"};
+inline constexpr const char* font2_1066[] = {"**   ", " *   ", " *** ", " *  *", " *  *", " *** "};
+inline constexpr const char* font2_1067[] = {"*   *", "*   *", "*** *", "*  **", "*  **", "*** *"};
+inline constexpr const char* font2_1068[] = {"*    ", "*    ", "**** ", "*   *", "*   *", "**** "};
+inline constexpr const char* font2_1069[] = {"**** ", "    *", " ****", "    *", "    *", "**** "};
+inline constexpr const char* font2_1070[] = {"*  * ", "* * *", "*** *", "* * *", "* * *", "*  * "};
+inline constexpr const char* font2_1071[] = {" ****", "*   *", " ****", " *  *", " *  *", "*   *"};
+
+inline constexpr BuiltinGlyph font2[] = {
+	{65, 6, font2_65},
+	{66, 6, font2_66},
+	{67, 6, font2_67},
+	{68, 6, font2_68},
+	{69, 6, font2_69},
+	{70, 6, font2_70},
+	{71, 6, font2_71},
+	{72, 6, font2_72},
+	{73, 6, font2_73},
+	{74, 6, font2_74},
+	{75, 6, font2_75},
+	{76, 6, font2_76},
+	{77, 6, font2_77},
+	{78, 6, font2_78},
+	{79, 6, font2_79},
+	{80, 6, font2_80},
+	{81, 6, font2_81},
+	{82, 6, font2_82},
+	{83, 6, font2_83},
+	{84, 6, font2_84},
+	{85, 6, font2_85},
+	{86, 6, font2_86},
+	{87, 6, font2_87},
+	{88, 6, font2_88},
+	{89, 6, font2_89},
+	{90, 6, font2_90},
+	{1025, 6, font2_1025},
+	{1040, 6, font2_1040},
+	{1041, 6, font2_1041},
+	{1042, 6, font2_1042},
+	{1043, 6, font2_1043},
+	{1044, 6, font2_1044},
+	{1045, 6, font2_1045},
+	{1046, 6, font2_1046},
+	{1047, 6, font2_1047},
+	{1048, 6, font2_1048},
+	{1049, 6, font2_1049},
+	{1050, 6, font2_1050},
+	{1051, 6, font2_1051},
+	{1052, 6, font2_1052},
+	{1053, 6, font2_1053},
+	{1054, 6, font2_1054},
+	{1055, 6, font2_1055},
+	{1056, 6, font2_1056},
+	{1057, 6, font2_1057},
+	{1058, 6, font2_1058},
+	{1059, 6, font2_1059},
+	{1060, 6, font2_1060},
+	{1061, 6, font2_1061},
+	{1062, 6, font2_1062},
+	{1063, 6, font2_1063},
+	{1064, 6, font2_1064},
+	{1065, 6, font2_1065},
+	{1066, 6, font2_1066},
+	{1067, 6, font2_1067},
+	{1068, 6, font2_1068},
+	{1069, 6, font2_1069},
+	{1070, 6, font2_1070},
+	{1071, 6, font2_1071},
+};
+
+inline constexpr BuiltinKerning font2_kerning[] = {
+	{65, 84, -1},
+	{65, 86, -1},
+	{65, 87, -1},
+	{65, 89, -1},
+	{70, 65, -1},
+	{76, 84, -1},
+	{76, 86, -1},
+	{76, 89, -1},
+	{80, 65, -1},
+	{84, 65, -1},
+	{86, 65, -1},
+	{87, 65, -1},
+	{89, 65, -1},
+	{1040, 1058, -1},
+	{1040, 1059, -1},
+	{1043, 1040, -1},
+	{1044, 1040, -1},
+	{1058, 1040, -1},
+	{1059, 1040, -1},
+};
+
+inline constexpr BuiltinFont fonts[] = {
+	{"1", font1, sizeof(font1) / sizeof(BuiltinGlyph), font1_kerning, 19},
+	{"2", font2, sizeof(font2) / sizeof(BuiltinGlyph), font2_kerning, 19},
+};
+
+} // namespace builtin_fonts
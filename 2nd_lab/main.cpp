@@ -3,20 +3,76 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <array>
+#include <list>
+#include <optional>
 #include <unordered_map>
 #include <algorithm>
 #include <cctype>
 #include <limits>
 #include <clocale>
 #include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <cerrno>
+#include <filesystem>
+#include <sstream>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <random>
+#include <chrono>
 #ifdef _WIN32
 #include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <sys/timerfd.h>
 #endif
 
 
 
 using namespace std;
 
+// счетчик выделений памяти для бенчмарков (--bench): глобальный operator new считает вызовы и байты.
+// Только в сборке с -DBANNER_ALLOC_HOOK, в обычной сборке new не подменяется и --bench не знает число выделений
+namespace alloc_stats {
+	atomic<size_t> count{0};
+	atomic<size_t> bytes{0};
+#ifdef BANNER_ALLOC_HOOK
+	constexpr bool enabled = true;
+#else
+	constexpr bool enabled = false;
+#endif
+}
+
+#ifdef BANNER_ALLOC_HOOK
+#ifdef __GNUC__
+#define ALLOC_HOOK_NOINLINE __attribute__((noinline)) // иначе GCC видит malloc/free на месте вызова и ложно ругается на пару new/free
+#else
+#define ALLOC_HOOK_NOINLINE
+#endif
+ALLOC_HOOK_NOINLINE void* operator new(size_t size) {
+	alloc_stats::count.fetch_add(1, memory_order_relaxed);
+	alloc_stats::bytes.fetch_add(size, memory_order_relaxed);
+	if (void* p = malloc(size ? size : 1)) return p;
+	throw bad_alloc();
+}
+ALLOC_HOOK_NOINLINE void operator delete(void* p) noexcept { free(p); }
+ALLOC_HOOK_NOINLINE void operator delete(void* p, size_t) noexcept { free(p); }
+#endif
+
 enum class Color {
 	BLACK = 30,
 	RED = 31,
@@ -47,198 +103,3250 @@ Color stringToColor(string colorStr) {
 	return it == colorMap.end() ? Color::WHITE : it->second; //if iter of map -> to out of range: def color white, else iter -> value   
 }
 
+
+// цвет текста: базовый SGR-цвет (Color), индекс 256-цветной палитры или 24-битный RGB, упакованный в 32 бита
+class Paint {
+public:
+	enum class Kind : uint8_t { BASIC, INDEXED, RGB };
+
+private:
+	uint32_t packed; // старший байт - Kind, младшие 24 бита - значение
+
+	constexpr Paint(Kind kind, uint32_t value) : packed(static_cast<uint32_t>(kind) << 24 | (value & 0xFFFFFF)) {}
+
+public:
+	constexpr Paint(Color color = Color::RESET) : Paint(Kind::BASIC, static_cast<uint32_t>(color)) {}
+	static constexpr Paint indexed(uint8_t index) { return Paint(Kind::INDEXED, index); }
+	static constexpr Paint rgb(uint8_t r, uint8_t g, uint8_t b) { return Paint(Kind::RGB, uint32_t(r) << 16 | uint32_t(g) << 8 | b); }
+
+	Kind kind() const { return static_cast<Kind>(packed >> 24); }
+	uint32_t value() const { return packed & 0xFFFFFF; }
+	uint32_t raw() const { return packed; }
+	bool operator==(const Paint& other) const { return packed == other.packed; }
+	bool operator!=(const Paint& other) const { return packed != other.packed; }
+
+	// приблизительный RGB для любого вида цвета (нужен градиентам), 0xRRGGBB
+	uint32_t toRgb() const {
+		static const uint32_t basic[8] = {0x000000, 0xCD0000, 0x00CD00, 0xCDCD00, 0x0000EE, 0xCD00CD, 0x00CDCD, 0xE5E5E5};
+		static const uint32_t system[16] = {0x000000, 0x800000, 0x008000, 0x808000, 0x000080, 0x800080, 0x008080, 0xC0C0C0,
+											0x808080, 0xFF0000, 0x00FF00, 0xFFFF00, 0x0000FF, 0xFF00FF, 0x00FFFF, 0xFFFFFF};
+		switch (kind()) {
+		case Kind::RGB:
+			return value();
+		case Kind::INDEXED: {
+			const uint32_t i = value();
+			if (i < 16) return system[i];
+			if (i >= 232) { // оттенки серого
+				uint32_t v = 8 + (i - 232) * 10;
+				return v << 16 | v << 8 | v;
+			}
+			auto level = [](uint32_t c) { return c == 0 ? 0u : 55 + c * 40; }; // куб 6x6x6
+			const uint32_t c = i - 16;
+			return level(c / 36) << 16 | level(c / 6 % 6) << 8 | level(c % 6);
+		}
+		default:
+			return (value() >= 30 && value() <= 37) ? basic[value() - 30] : 0xE5E5E5;
+		}
+	}
+};
+
+// "red", "#ff8800" (RGB) или "0".."255" (индекс палитры)
+Paint stringToPaint(const string& colorStr) {
+	if (colorStr.size() == 7 && colorStr[0] == '#' &&
+		all_of(colorStr.begin() + 1, colorStr.end(), [](char ch) { return isxdigit(static_cast<unsigned char>(ch)); })) {
+		const unsigned long v = stoul(colorStr.substr(1), nullptr, 16);
+		return Paint::rgb(static_cast<uint8_t>(v >> 16), static_cast<uint8_t>(v >> 8), static_cast<uint8_t>(v));
+	}
+	if (!colorStr.empty() && colorStr.size() <= 3 && all_of(colorStr.begin(), colorStr.end(), [](char ch) { return isdigit(static_cast<unsigned char>(ch)); })) {
+		const int index = stoi(colorStr);
+		if (index <= 255) return Paint::indexed(static_cast<uint8_t>(index));
+	}
+	return stringToColor(colorStr);
+}
+
+// градиент по столбцам или по строкам баннера, цвета интерполируются в RGB
+struct Gradient {
+	enum class Direction { COLUMNS, ROWS };
+
+	Paint from;
+	Paint to;
+	Direction direction = Direction::COLUMNS;
+
+	Paint at(int i, int count) const { // i-й цвет из count
+		const uint32_t a = from.toRgb(), b = to.toRgb();
+		const int span = max(1, count - 1);
+		i = max(0, min(i, span));
+		auto mix = [&](int shift) {
+			const int ca = (a >> shift) & 0xFF, cb = (b >> shift) & 0xFF;
+			return static_cast<uint8_t>(ca + (cb - ca) * i / span);
+		};
+		return Paint::rgb(mix(16), mix(8), mix(0));
+	}
+};
+
 //https://gist.github.com/fnky/458719343aabd01cfb17a3a4f7296797
 class ANSICodes {
+private:
+	// все последовательности цвета посчитаны один раз: базовые и 256 индексов целиком, для RGB - десятичные числа 0..255
+	struct SequenceTable {
+		array<string, 38> basic;
+		array<string, 256> indexed;
+		array<string, 256> decimal;
+
+		SequenceTable() {
+			for (int i = 0; i < 256; i++) {
+				decimal[i] = to_string(i);
+				indexed[i] = "\033[38;5;" + decimal[i] + "m";
+			}
+			for (int i = 0; i < 38; i++) basic[i] = "\033[" + to_string(i) + "m";
+		}
+	};
+
+	static const SequenceTable& table() {
+		static const SequenceTable sequences;
+		return sequences;
+	}
+
 public:
-	static string clearScreen() { 
-        return "\033[2J\033[H";
+	static const string& clearScreen() { 
+        static const string sequence = "\033[2J\033[H";
+        return sequence;
     }
 	static string setColor(Color color) {
-        return "\033[" + to_string(static_cast<int>(color)) + "m"; 
+        return table().basic[static_cast<int>(color) % 38]; 
     }
-	static string resetColor() {
-        return "\033[0m";
+	static string setColor(Paint paint) {
+		string out;
+		appendColor(out, paint);
+		return out;
+	}
+	// дописывает последовательность цвета в out без временных строк
+	static void appendColor(string& out, Paint paint) {
+		const SequenceTable& t = table();
+		switch (paint.kind()) {
+		case Paint::Kind::BASIC:
+			out += t.basic[paint.value() % 38];
+			break;
+		case Paint::Kind::INDEXED:
+			out += t.indexed[paint.value() & 0xFF];
+			break;
+		case Paint::Kind::RGB:
+			out += "\033[38;2;";
+			out += t.decimal[(paint.value() >> 16) & 0xFF];
+			out += ';';
+			out += t.decimal[(paint.value() >> 8) & 0xFF];
+			out += ';';
+			out += t.decimal[paint.value() & 0xFF];
+			out += 'm';
+			break;
+		}
+	}
+	static size_t colorLength(Paint paint) {
+		const SequenceTable& t = table();
+		switch (paint.kind()) {
+		case Paint::Kind::BASIC:
+			return t.basic[paint.value() % 38].size();
+		case Paint::Kind::INDEXED:
+			return t.indexed[paint.value() & 0xFF].size();
+		default:
+			return 10 + t.decimal[(paint.value() >> 16) & 0xFF].size() + t.decimal[(paint.value() >> 8) & 0xFF].size() +
+				   t.decimal[paint.value() & 0xFF].size();
+		}
+	}
+	static const string& resetColor() {
+        static const string sequence = "\033[0m";
+        return sequence;
     }
 	static string moveCursor(int row, int col) {
         return "\033[" + to_string(row) + ";" + to_string(col) + "H";
     }
 };
 
-//load templates symbols from text{fontId}.txt
-class FontLoader {
-private:
-	//static означает, что эти переменные общие для всех объектов класса.
-	static unordered_map<string, map<char, vector<string>>> templatesByFont; //un_map(str-map(ch-list(str)))
-	static unordered_map<string, bool> loaded;
+// ключ глифа - код символа Unicode, буквы хранятся в верхнем регистре
+using FontTemplates = map<char32_t, vector<string>>;
+using KerningTable = map<pair<char32_t, char32_t>, int>; // сдвиг второго глифа пары в ячейках (обычно отрицательный)
 
-public:
-	static void loadFont(const string& fontId) { //static method can be used without creating object:) 
-		if (loaded.count(fontId)) { // if loaded unempty leaving method 
-			return;
+// верхний регистр для латиницы и кириллицы (включая Ё), остальные символы как есть
+char32_t foldCase(char32_t cp) {
+	if (cp >= 'a' && cp <= 'z') return cp - 0x20;
+	if (cp >= 0x430 && cp <= 0x44F) return cp - 0x20; // а..я
+	if (cp >= 0x450 && cp <= 0x45F) return cp - 0x50; // ѐ..џ, в том числе ё
+	return cp;
+}
+
+// длина последовательности UTF-8 по первому байту (1 - ASCII или неверный байт)
+size_t utf8SequenceLength(unsigned char lead) {
+	if (lead >= 0xF0 && lead <= 0xF4) return 4;
+	if (lead >= 0xE0 && lead <= 0xEF) return 3;
+	if (lead >= 0xC2 && lead <= 0xDF) return 2;
+	return 1;
+}
+
+// следующий символ UTF-8; неверная или обрезанная последовательность дает U+FFFD и сдвиг на один байт
+char32_t decodeUtf8(const char*& p, const char* end) {
+	const unsigned char lead = static_cast<unsigned char>(*p);
+	if (lead < 0x80) {
+		p++;
+		return lead;
+	}
+	const size_t length = utf8SequenceLength(lead);
+	if (length == 1 || static_cast<size_t>(end - p) < length) {
+		p++;
+		return 0xFFFD;
+	}
+	char32_t cp = lead & (0xFF >> (length + 1));
+	for (size_t i = 1; i < length; i++) {
+		const unsigned char next = static_cast<unsigned char>(p[i]);
+		if ((next & 0xC0) != 0x80) {
+			p++;
+			return 0xFFFD;
 		}
+		cp = cp << 6 | (next & 0x3F);
+	}
+	static const char32_t minimum[5] = {0, 0, 0x80, 0x800, 0x10000};
+	if (cp < minimum[length] || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF)) { // лишне длинная запись, суррогаты
+		p++;
+		return 0xFFFD;
+	}
+	p += length;
+	return cp;
+}
 
-		string filename = "text" + fontId + ".txt";
-		ifstream file(filename);
-		if (!file.is_open()) {
-			cerr << "Ошибка загрузки файла шрифта: " << filename << endl;
-			templatesByFont[fontId] = {}; // empty map for this ID 
-			loaded[fontId] = true; // mark as done
-			return;
+// обход текста по символам за один проход: слово из 8 ASCII байт идет в f без проверок по байтам,
+// иначе до 8 байт разбираются по одному (decodeUtf8 - с байта >= 0x80), и снова проверка слова
+template <typename F>
+void forEachCodePoint(const char* data, size_t size, F&& f) {
+	const char* p = data;
+	const char* const end = data + size;
+	while (p < end) {
+		for (uint64_t word; end - p >= 8; p += 8) {
+			memcpy(&word, p, sizeof(word));
+			if (word & 0x8080808080808080ull) break;
+			for (int i = 0; i < 8; i++) f(static_cast<char32_t>(static_cast<unsigned char>(p[i])));
+		}
+		for (const char* const stop = p + min<ptrdiff_t>(8, end - p); p < stop;) {
+			const unsigned char byte = static_cast<unsigned char>(*p);
+			if (byte < 0x80) {
+				f(static_cast<char32_t>(byte));
+				p++;
+			} else {
+				f(decodeUtf8(p, end));
+			}
 		}
+	}
+}
+
+template <typename F>
+void forEachCodePoint(const string& text, F&& f) {
+	forEachCodePoint(text.data(), text.size(), f);
+}
+
+// разбор текстового шрифта (UTF-8): строка из одного символа после пустой строки - ключ, дальше строки шаблона;
+// между шаблонами могут стоять строки кернинга "@kern AV -1"
+FontTemplates parseFontText(istream& in, KerningTable* kerning = nullptr) {
+	FontTemplates font;
+	string line;
+	char32_t currentChar = 0;
+	auto codePoints = [](const string& text) {
+		vector<char32_t> out;
+		forEachCodePoint(text, [&](char32_t cp) { out.push_back(cp); });
+		return out;
+	};
+	vector<string> currentTemplate;
+	bool expectKey = true; // ключ идет в начале файла и после пустой строки, иначе строка "*" - часть шаблона
 
-		string line; 
-		char currentChar = 0;
-		vector<string> currentTemplate;
+	while (getline(in, line)) {
+		//delete  \r 
+		if (!line.empty() && line.back() == '\r') {
+			line.pop_back();
+		}
 
-		while (getline(file, line)) {
-			//delete  \r 
-			if (!line.empty() && line.back() == '\r') {
-				line.pop_back();
+		if (line.empty()) {  // making massive, if line empty
+			if (!currentTemplate.empty() && currentChar != 0) { //if cT not empty and cC is valid 
+				font[currentChar] = currentTemplate;
+				currentTemplate.clear();
 			}
+			expectKey = true;
+			continue;
+		}
 
-			if (line.empty()) {  // making massive, if line empty
-				if (!currentTemplate.empty() && currentChar != 0) { //if cT not empty and cC is valid 
-					templatesByFont[fontId][currentChar] = currentTemplate; //fill tBF 
-					currentTemplate.clear();
-				}
-				continue;
+		if (expectKey && line.rfind("@kern ", 0) == 0) {
+			istringstream pair(line.substr(6));
+			string chars;
+			int adjust = 0;
+			if (kerning != nullptr && pair >> chars >> adjust) {
+				const vector<char32_t> keys = codePoints(chars);
+				if (keys.size() == 2) (*kerning)[{foldCase(keys[0]), foldCase(keys[1])}] = adjust;
 			}
+			continue; // expectKey не сбрасываем: строки кернинга идут подряд
+		}
 
-			if (currentTemplate.empty() && line.size() == 1) { //if "Ch" in line  
-				currentChar = static_cast<char>(toupper(static_cast<unsigned char>(line[0]))); //set ch for map as key
-			} else {
-				currentTemplate.push_back(line);
+		const vector<char32_t> key = expectKey && currentTemplate.empty() ? codePoints(line) : vector<char32_t>();
+		if (key.size() == 1) { //if "Ch" in line  
+			currentChar = foldCase(key[0]); //set ch for map as key
+		} else {
+			currentTemplate.push_back(line);
+		}
+		expectKey = false;
+	}
+
+	if (!currentTemplate.empty() && currentChar != 0) {
+		font[currentChar] = currentTemplate; //packing done template to map
+	}
+	return font;
+}
+
+// скомпилированный шрифт text{id}.fnt: заголовок, таблица глифов и упакованные побитно строки
+// little-endian, все поля выровнены, файл читается через mmap без разбора текста
+class CompiledFont {
+public:
+	static constexpr char MAGIC[4] = {'B', 'F', 'N', 'T'};
+	static constexpr uint16_t VERSION = 3;
+
+	struct Header {
+		char magic[4];
+		uint16_t version;
+		uint16_t glyphCount;
+		uint32_t fileSize;
+		uint32_t bitmapOffset;  // начало упакованных строк
+		uint32_t kerningCount;  // записи кернинга идут сразу после таблицы глифов
+		uint32_t padding;       // выравнивание sourceSize, всегда 0 (без поля в файл попадал бы мусор со стека)
+		uint64_t sourceSize;    // размер и время изменения text{id}.txt, по ним определяем устаревание
+		int64_t sourceMtime;
+	};
+
+	struct GlyphEntry {
+		uint32_t key;           // код символа Unicode
+		uint8_t width;          // ширина в ячейках
+		uint8_t rows;
+		uint16_t reserved;
+		uint32_t offset;        // смещение от bitmapOffset, на строку ceil(width / 8) байт, старший бит - левая ячейка
+	};
+
+	struct KerningEntry {
+		uint32_t left;
+		uint32_t right;
+		int8_t adjust;
+		uint8_t reserved[3];
+	};
+
+	static string textPath(const string& fontId, const string& dir = ".") {
+		return (filesystem::path(dir) / ("text" + fontId + ".txt")).string();
+	}
+	static string binaryPath(const string& fontId, const string& dir = ".") {
+		return (filesystem::path(dir) / ("text" + fontId + ".fnt")).string();
+	}
+
+	static bool sourceStamp(const string& path, uint64_t& size, int64_t& mtime) {
+		error_code ec;
+		size = filesystem::file_size(path, ec);
+		if (ec) return false;
+		auto time = filesystem::last_write_time(path, ec);
+		if (ec) return false;
+		mtime = static_cast<int64_t>(time.time_since_epoch().count());
+		return true;
+	}
+
+	// text{id}.txt -> text{id}.fnt
+	static bool compile(const string& fontId) {
+		const string source = textPath(fontId);
+		ifstream in(source);
+		if (!in.is_open()) {
+			cerr << "Ошибка загрузки файла шрифта: " << source << endl;
+			return false;
+		}
+		KerningTable kerning;
+		FontTemplates font = parseFontText(in, &kerning);
+		in.close();
+
+		Header header;
+		memset(&header, 0, sizeof(header));
+		memcpy(header.magic, MAGIC, sizeof(MAGIC));
+		header.version = VERSION;
+		header.glyphCount = static_cast<uint16_t>(font.size());
+		header.kerningCount = static_cast<uint32_t>(kerning.size());
+		header.bitmapOffset = static_cast<uint32_t>(sizeof(Header) + font.size() * sizeof(GlyphEntry) +
+													 kerning.size() * sizeof(KerningEntry));
+		if (!sourceStamp(source, header.sourceSize, header.sourceMtime)) return false;
+
+		vector<GlyphEntry> index;
+		string bitmap;
+		for (const auto& [key, rows] : font) {
+			size_t width = 0;
+			for (const string& row : rows) width = max(width, row.size());
+			if (width > 255 || rows.size() > 255) {
+				cerr << "Глиф слишком большой для формата: U+" << hex << static_cast<uint32_t>(key) << dec << endl;
+				return false;
+			}
+			GlyphEntry entry{static_cast<uint32_t>(key), static_cast<uint8_t>(width), static_cast<uint8_t>(rows.size()), 0,
+							 static_cast<uint32_t>(bitmap.size())};
+			const size_t rowBytes = (width + 7) / 8;
+			for (const string& row : rows) {
+				string packed(rowBytes, '\0');
+				for (size_t c = 0; c < row.size(); c++) {
+					if (row[c] != ' ') packed[c / 8] = static_cast<char>(packed[c / 8] | (0x80 >> (c % 8)));
+				}
+				bitmap += packed;
 			}
+			index.push_back(entry);
 		}
+		header.fileSize = static_cast<uint32_t>(header.bitmapOffset + bitmap.size());
 
-		if (!currentTemplate.empty() && currentChar != 0) {
-			templatesByFont[fontId][currentChar] = currentTemplate; //packing done template to map
+		vector<KerningEntry> kerningIndex;
+		for (const auto& [pair, adjust] : kerning) {
+			kerningIndex.push_back({static_cast<uint32_t>(pair.first), static_cast<uint32_t>(pair.second),
+									static_cast<int8_t>(max(-128, min(127, adjust))), {0, 0, 0}});
 		}
 
-		loaded[fontId] = true;
-		file.close();
+		ofstream out(binaryPath(fontId), ios::binary | ios::trunc);
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		out.write(reinterpret_cast<const char*>(index.data()), static_cast<streamsize>(index.size() * sizeof(GlyphEntry)));
+		out.write(reinterpret_cast<const char*>(kerningIndex.data()),
+				  static_cast<streamsize>(kerningIndex.size() * sizeof(KerningEntry)));
+		out.write(bitmap.data(), static_cast<streamsize>(bitmap.size()));
+		return static_cast<bool>(out);
 	}
 
-	static const map<char, vector<string>>& getFont(const string& fontId) {   //return tBF by font id   
-		return templatesByFont[fontId];
+	// false - файла нет, он поврежден или старше text{id}.txt; тогда нужен текстовый разбор
+	static bool load(const string& fontId, FontTemplates& font, KerningTable& kerning, const string& dir = ".") {
+		const string path = binaryPath(fontId, dir);
+		MappedFile file(path);
+		if (!file.data() || file.size() < sizeof(Header)) return false;
+
+		Header header;
+		memcpy(&header, file.data(), sizeof(header));
+		if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION || header.fileSize != file.size() ||
+			header.bitmapOffset != sizeof(Header) + header.glyphCount * sizeof(GlyphEntry) +
+				static_cast<size_t>(header.kerningCount) * sizeof(KerningEntry)) {
+			return false;
+		}
+
+		uint64_t sourceSize;
+		int64_t sourceMtime;
+		if (sourceStamp(textPath(fontId, dir), sourceSize, sourceMtime) &&
+			(sourceSize != header.sourceSize || sourceMtime != header.sourceMtime)) {
+			return false; // исходник менялся после компиляции
+		}
+
+		const unsigned char* base = file.data();
+		for (uint16_t g = 0; g < header.glyphCount; g++) {
+			GlyphEntry entry;
+			memcpy(&entry, base + sizeof(Header) + g * sizeof(GlyphEntry), sizeof(entry));
+			const size_t rowBytes = (entry.width + 7) / 8;
+			if (header.bitmapOffset + static_cast<size_t>(entry.offset) + rowBytes * entry.rows > file.size()) return false;
+
+			const unsigned char* bits = base + header.bitmapOffset + entry.offset;
+			vector<string> rows(entry.rows, string(entry.width, ' '));
+			for (size_t r = 0; r < entry.rows; r++, bits += rowBytes) {
+				for (size_t c = 0; c < entry.width; c++) {
+					if (bits[c / 8] & (0x80 >> (c % 8))) rows[r][c] = '*';
+				}
+			}
+			font[static_cast<char32_t>(entry.key)] = move(rows);
+		}
+
+		const unsigned char* kerningBase = base + sizeof(Header) + header.glyphCount * sizeof(GlyphEntry);
+		for (uint32_t k = 0; k < header.kerningCount; k++) {
+			KerningEntry entry;
+			memcpy(&entry, kerningBase + k * sizeof(KerningEntry), sizeof(entry));
+			kerning[{static_cast<char32_t>(entry.left), static_cast<char32_t>(entry.right)}] = entry.adjust;
+		}
+		return true;
 	}
+
+private:
+	// файл только для чтения, отображенный в память (на Windows просто читается целиком)
+	class MappedFile {
+		const unsigned char* ptr = nullptr;
+		size_t length = 0;
+#ifdef _WIN32
+		string buffer;
+#endif
+	public:
+		explicit MappedFile(const string& path) {
+#ifdef _WIN32
+			ifstream in(path, ios::binary);
+			if (!in.is_open()) return;
+			buffer.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+			ptr = reinterpret_cast<const unsigned char*>(buffer.data());
+			length = buffer.size();
+#else
+			int fd = open(path.c_str(), O_RDONLY);
+			if (fd < 0) return;
+			struct stat st;
+			if (fstat(fd, &st) == 0 && st.st_size > 0) {
+				void* mapped = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+				if (mapped != MAP_FAILED) {
+					ptr = static_cast<const unsigned char*>(mapped);
+					length = static_cast<size_t>(st.st_size);
+				}
+			}
+			close(fd);
+#endif
+		}
+		~MappedFile() {
+#ifndef _WIN32
+			if (ptr) munmap(const_cast<unsigned char*>(ptr), length);
+#endif
+		}
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		const unsigned char* data() const { return ptr; }
+		size_t size() const { return length; }
+	};
 };
 
-unordered_map<string, map<char, vector<string>>> FontLoader::templatesByFont; // allocate memory for ts vars out of class 119-120
-unordered_map<string, bool> FontLoader::loaded;
+// готовый к отрисовке шрифт: все глифы лежат подряд в одном буфере ячеек (строки выровнены по ширине и высоте).
+// Коды 0..255 ищутся в одной таблице, остальные - в двухуровневой (страница по старшим битам кода, 256 номеров в странице);
+// регистр уже учтен в таблицах, неизвестные символы указывают на пустой глиф
+class Font {
+public:
+	struct Glyph {
+		uint32_t offset;      // начало глифа в cells, строки по width ячеек
+		uint32_t maskOffset;  // начало глифа в masks, строки по ceil(width / 8) байт
+		uint16_t width;
+	};
+
+private:
+	int glyphHeight = 0;
+	array<uint16_t, 256> index{};        // ASCII и Latin-1
+	vector<uint16_t> pageOf;             // код >> 8 -> номер страницы в pages, 0 - страницы нет
+	vector<array<uint16_t, 256>> pages;  // pages[0] пустая
+	vector<Glyph> glyphs;
+	string cells;
+	vector<uint8_t> masks;    // те же строки побитно: старший бит - левая ячейка, 1 - закрашено
+	unordered_map<uint32_t, int> kerningByGlyph; // (номер левого глифа << 16 | номер правого) -> сдвиг
 
-class Printer {
+public:
+	static Font fromTemplates(const FontTemplates& templates, const KerningTable& kerning = {}) {
+		Font font;
+		for (const auto& kv : templates) {
+			font.glyphHeight = max(font.glyphHeight, static_cast<int>(kv.second.size())); // normalize height by max highest tamplate
+		}
+
+		auto addGlyph = [&font](const vector<string>& rows, size_t width) {
+			Glyph glyph{static_cast<uint32_t>(font.cells.size()), static_cast<uint32_t>(font.masks.size()), static_cast<uint16_t>(width)};
+			for (int r = 0; r < font.glyphHeight; r++) {
+				string row = r < static_cast<int>(rows.size()) ? rows[r] : string();
+				row.resize(width, ' ');
+				font.cells += row;
+				const size_t rowBytes = (width + 7) / 8;
+				font.masks.resize(font.masks.size() + rowBytes, 0);
+				uint8_t* bits = font.masks.data() + font.masks.size() - rowBytes;
+				for (size_t c = 0; c < width; c++) {
+					if (row[c] != ' ') bits[c / 8] |= static_cast<uint8_t>(0x80 >> (c % 8));
+				}
+			}
+			font.glyphs.push_back(glyph);
+			return static_cast<uint16_t>(font.glyphs.size() - 1);
+		};
+		auto computeGlyphWidth = [](const vector<string>& tmpl) {
+			size_t w = 0;
+			for (const string& row : tmpl) w = max(w, row.size());
+			return w;
+		};
+
+		// нулевой глиф - пробелы для неизвестных символов, ширина по первому шаблону
+		addGlyph({}, templates.empty() ? 0 : computeGlyphWidth(templates.begin()->second));
+		map<char32_t, uint16_t> byKey;
+		for (const auto& [key, rows] : templates) byKey[key] = addGlyph(rows, computeGlyphWidth(rows));
+		auto lookup = [&byKey](char32_t cp) -> uint16_t { // регистр учитываем здесь, а не на каждом символе текста
+			auto it = byKey.find(cp);
+			if (it == byKey.end()) it = byKey.find(foldCase(cp));
+			return it == byKey.end() ? 0 : it->second;
+		};
+		for (char32_t cp = 0; cp < 256; cp++) font.index[cp] = lookup(cp);
+		font.pages.emplace_back(); // пустая страница
+		for (const auto& entry : byKey) {
+			const size_t page = entry.first >> 8;
+			if (page == 0) continue;
+			if (font.pageOf.size() <= page) font.pageOf.resize(page + 1, 0);
+			if (font.pageOf[page] != 0) continue; // страница уже заполнена
+			font.pageOf[page] = static_cast<uint16_t>(font.pages.size());
+			font.pages.emplace_back();
+			for (char32_t low = 0; low < 256; low++) font.pages.back()[low] = lookup(static_cast<char32_t>(page << 8 | low));
+		}
+		for (const auto& [pair, adjust] : kerning) {
+			auto left = byKey.find(pair.first), right = byKey.find(pair.second);
+			if (left != byKey.end() && right != byKey.end()) {
+				font.kerningByGlyph[static_cast<uint32_t>(left->second) << 16 | right->second] = adjust;
+			}
+		}
+		return font;
+	}
+
+	bool empty() const { return glyphs.size() <= 1; }
+	int height() const { return glyphHeight; }
+
+	uint16_t glyphIndex(char32_t c) const {
+		if (c < 256) return index[c];
+		const size_t page = c >> 8;
+		return page < pageOf.size() ? pages[pageOf[page]][c & 0xFF] : 0;
+	}
+	const Glyph& glyph(char32_t c) const { return glyphs[glyphIndex(c)]; }
+	int defaultWidth() const { return glyphs.front().width; }
+	bool isBlank(char32_t c) const { return glyphIndex(c) == 0; } // нет глифа - рисуются только пробелы
+
+	// кернинг пары символов (учитывается раскладкой TextLayout, обычный вывод его не применяет)
+	int kerning(char32_t left, char32_t right) const {
+		if (kerningByGlyph.empty()) return 0;
+		auto it = kerningByGlyph.find(static_cast<uint32_t>(glyphIndex(left)) << 16 | glyphIndex(right));
+		return it == kerningByGlyph.end() ? 0 : it->second;
+	}
+	const char* row(const Glyph& glyph, int r) const { return cells.data() + glyph.offset + static_cast<size_t>(r) * glyph.width; }
+	const uint8_t* mask(const Glyph& glyph, int r) const { return masks.data() + glyph.maskOffset + static_cast<size_t>(r) * ((glyph.width + 7) / 8); }
+};
+
+// развертка битовой маски строки глифа в UTF-8 текст: таблица на 256 байт маски, каждый шаг - 8 ячеек одним memcpy.
+// Для однобайтового символа запись таблицы - ровно 8 байт, для многобайтовых - до 32 байт и ее длина
+class SymbolExpander {
 private:
-	Color color;
-	pair<int, int> position; // {row, col}, 1-based
-	string fontId;
 	string symbol;
+	size_t slot;                 // размер записи таблицы, с запасом до кратного 8
+	vector<char> table;          // 256 записей по slot байт
+	array<uint32_t, 256> lengths; // реальная длина развертки каждой записи (8 длинных символов не помещаются в байт)
 
 public:
-	// static output
-	static void printStatic(const string& text,
-							Color color,
-							const pair<int, int>& position,
-							const string& symbol = "*",
-							const string& fontId = "1") {
-		FontLoader::loadFont(fontId);
-		const auto& font = FontLoader::getFont(fontId);
-		if (font.empty()) {
-			#ifdef _WIN32
-				SetConsoleOutputCP(65001);
-			#endif
-			cerr << "Шрифт не загружен или пуст: " << fontId << endl;
-			return;
+	explicit SymbolExpander(const string& symbol) : symbol(symbol.empty() ? "*" : symbol) {
+		const size_t size = this->symbol.size();
+		slot = (8 * size + 7) / 8 * 8;
+		table.assign(256 * slot, ' ');
+		for (int mask = 0; mask < 256; mask++) {
+			char* entry = &table[mask * slot];
+			size_t length = 0;
+			for (int c = 0; c < 8; c++) {
+				if (mask & (0x80 >> c)) {
+					memcpy(entry + length, this->symbol.data(), size);
+					length += size;
+				} else {
+					entry[length++] = ' ';
+				}
+			}
+			lengths[mask] = static_cast<uint32_t>(length);
+		}
+	}
+
+	size_t symbolSize() const { return symbol.size(); }
+	size_t slack() const { return slot; } // сколько байт после конца развертки может быть перезаписано
+
+	// развертка cells ячеек маски в out, возвращает конец записанного; в буфере нужно cells * symbolSize() + slack() байт
+	char* expand(char* out, const uint8_t* mask, int cells) const {
+		for (; cells >= 8; cells -= 8, mask++) {
+			memcpy(out, &table[*mask * slot], slot);
+			out += lengths[*mask];
+		}
+		if (cells > 0) { // неполный байт: берем начало записи - cells ячеек, отброшенные ячейки - пробелы по одному байту
+			const uint8_t bits = static_cast<uint8_t>(*mask & (0xFF00 >> cells));
+			memcpy(out, &table[bits * slot], slot);
+			out += lengths[bits] - (8 - cells);
 		}
+		return out;
+	}
 
-        // normalize height by max highest tamplate
-        int height = 0;
-        for (const auto& kv : font) {
-            height = max(height, static_cast<int>(kv.second.size())); //choose max between string in vec of templ and pervious height
-        }
-        vector<string> outputLines(height, "");
-
-        // Собираем строки вывода с нормализацией ширины/высоты
-        auto computeGlyphWidth = [](const vector<string>& tmpl) -> int {
-            int w = 0;
-            for (const string& row : tmpl) {
-                w = max(w, static_cast<int>(row.size()));
-            }
-            return w;
-        };
-
-        // Ширина по умолчанию для неизвестных символов — по первому шаблону
-        int defaultWidth = 0;
-        if (!font.empty()) {
-            defaultWidth = computeGlyphWidth(font.begin()->second);
-        }
-
-        for (char raw : text) {
-			char c = static_cast<char>(toupper(static_cast<unsigned char>(raw)));
-			auto it = font.find(c);
-			if (it == font.end()) {
-                int width = defaultWidth;
-                for (int i = 0; i < height; i++) {
-                    outputLines[i] += string(max(0, width), ' ') + " ";
-                }
+	// то же с произвольной ячейки маски: серии градиента начинаются не на границе байта.
+	// Маска должна читаться на байт дальше последней ячейки
+	char* expand(char* out, const uint8_t* mask, size_t firstCell, int cells) const {
+		mask += firstCell / 8;
+		const unsigned shift = firstCell % 8;
+		if (shift == 0) return expand(out, mask, cells);
+		for (; cells > 0; cells -= 8, mask++) {
+			uint8_t bits = static_cast<uint8_t>(mask[0] << shift | mask[1] >> (8 - shift));
+			if (cells >= 8) {
+				memcpy(out, &table[bits * slot], slot);
+				out += lengths[bits];
 				continue;
 			}
-            const auto& tmpl = it->second;
-            const int glyphHeight = static_cast<int>(tmpl.size());
-            const int glyphWidth = computeGlyphWidth(tmpl);
-            for (int i = 0; i < height; i++) {
-                string line = (i < glyphHeight) ? tmpl[i] : string(glyphWidth, ' ');
-                if (static_cast<int>(line.size()) < glyphWidth) {
-                    line.append(glyphWidth - static_cast<int>(line.size()), ' ');
-                }
-                // Replace non-space characters with UTF-8 symbol
-                // Ensure symbol is not empty (fallback to "*")
-                string actualSymbol = symbol.empty() ? "*" : symbol;
-                string processedLine = "";
-                for (size_t j = 0; j < line.size(); j++) {
-                    if (line[j] != ' ') {
-                        processedLine += actualSymbol;
-                    } else {
-                        processedLine += ' ';
-                    }
-                }
-                line = processedLine;
-                outputLines[i] += line + " ";
-            }
-		}
-
-		// Очистка экрана и вертикальное смещение
-		cout << ANSICodes::clearScreen();
-		for (int i = 0; i < max(0, position.first - 1); i++) {
-			cout << '\n';
+			bits &= static_cast<uint8_t>(0xFF00 >> cells);
+			memcpy(out, &table[bits * slot], slot);
+			out += lengths[bits] - (8 - cells);
 		}
+		return out;
+	}
 
-		// Вывод с цветом и горизонтальным смещением
-		for (const auto& line : outputLines) {
-			cout << string(max(0, position.second - 1), ' ');
-			cout << ANSICodes::setColor(color) << line << ANSICodes::resetColor() << '\n';
+	// таблицы для последних использованных символов, у каждого потока свои
+	static const SymbolExpander& forSymbol(const string& symbol) {
+		thread_local unordered_map<string, unique_ptr<SymbolExpander>> expanders;
+		auto it = expanders.find(symbol);
+		if (it == expanders.end()) {
+			if (expanders.size() >= 16) expanders.clear();
+			it = expanders.emplace(symbol, make_unique<SymbolExpander>(symbol)).first;
 		}
+		return *it->second;
 	}
+};
 
-	// Экземпляр с фиксированным стилем
-	Printer(Color color, const pair<int, int>& position, const string& symbol = "*", const string& fontId = "1")
-		: color(color), position(position), fontId(fontId), symbol(symbol) {
-		FontLoader::loadFont(fontId);
+// встроенные шрифты, сгенерированные из text{id}.txt в fonts_builtin.hpp (./main --gen-builtin 1 2)
+struct BuiltinGlyph {
+	char32_t key;
+	uint8_t rows;
+	const char* const* lines;
+};
+
+struct BuiltinKerning {
+	char32_t left;
+	char32_t right;
+	int adjust;
+};
+
+struct BuiltinFont {
+	const char* id;
+	const BuiltinGlyph* glyphs;
+	size_t count;
+	const BuiltinKerning* kerning;
+	size_t kerningCount;
+};
+
+#if __has_include("fonts_builtin.hpp")
+#include "fonts_builtin.hpp"
+#else
+namespace builtin_fonts {
+inline constexpr BuiltinFont fonts[] = {{"", nullptr, 0, nullptr, 0}};
+}
+#endif
+
+// text{id}.txt -> заголовок с constexpr таблицами глифов
+bool generateBuiltinHeader(const vector<string>& fontIds, ostream& out) {
+	auto quote = [](const string& row) {
+		string q = "\"";
+		for (char ch : row) {
+			if (ch == '"' || ch == '\\') q += '\\';
+			q += ch;
+		}
+		return q + "\"";
+	};
+
+	out << "// generated by ./main --gen-builtin";
+	for (const string& id : fontIds) out << ' ' << id;
+	out << ", do not edit\n#pragma once\n\nnamespace builtin_fonts {\n";
+	vector<size_t> kerningCounts;
+	for (const string& id : fontIds) {
+		ifstream in(CompiledFont::textPath(id));
+		if (!in.is_open()) {
+			cerr << "Ошибка загрузки файла шрифта: " << CompiledFont::textPath(id) << endl;
+			return false;
+		}
+		KerningTable kerning;
+		FontTemplates font = parseFontText(in, &kerning);
+		for (const auto& [key, rows] : font) {
+			out << "\ninline constexpr const char* font" << id << "_" << static_cast<uint32_t>(key) << "[] = {";
+			for (size_t r = 0; r < rows.size(); r++) out << (r ? ", " : "") << quote(rows[r]);
+			out << "};";
+		}
+		out << "\n\ninline constexpr BuiltinGlyph font" << id << "[] = {\n";
+		for (const auto& [key, rows] : font) {
+			const uint32_t code = static_cast<uint32_t>(key);
+			out << "\t{" << code << ", " << rows.size() << ", font" << id << "_" << code << "},\n";
+		}
+		out << "};\n\ninline constexpr BuiltinKerning font" << id << "_kerning[] = {\n";
+		for (const auto& [pair, adjust] : kerning) {
+			out << "\t{" << static_cast<uint32_t>(pair.first) << ", " << static_cast<uint32_t>(pair.second) << ", " << adjust << "},\n";
+		}
+		if (kerning.empty()) out << "\t{0, 0, 0},\n"; // пустой массив в C++ недопустим
+		out << "};\n";
+		kerningCounts.push_back(kerning.size());
+	}
+	out << "\ninline constexpr BuiltinFont fonts[] = {\n";
+	for (size_t f = 0; f < fontIds.size(); f++) {
+		const string& id = fontIds[f];
+		out << "\t{" << quote(id) << ", font" << id << ", sizeof(font" << id << ") / sizeof(BuiltinGlyph), font" << id
+			<< "_kerning, " << kerningCounts[f] << "},\n";
+	}
+	out << "};\n\n} // namespace builtin_fonts\n";
+	return static_cast<bool>(out);
+}
+
+//load templates symbols: text{fontId}.fnt / text{fontId}.txt from font directory, otherwise built-in font
+// потокобезопасный реестр: каждый шрифт грузится один раз, остальные потоки ждут окончания загрузки,
+// загруженный шрифт неизменяем и публикуется атомарно, поиск на пути отрисовки идет без блокировок
+class FontLoader {
+private:
+	struct Snapshot {
+		Font font;
+		mutable atomic<int> pins{0};             // сколько ReadGuard держат этот снимок
+		explicit Snapshot(Font font) : font(move(font)) {}
+	};
+
+	struct Slot {
+		once_flag once;                          // загрузка ровно один раз, ожидающие блокируются на ней
+		atomic<const Snapshot*> current{nullptr}; // текущий снимок, при перезагрузке подменяется целиком
+		unique_ptr<const Snapshot> owner;
+		atomic<unsigned> generation{0};          // номер снимка, растет при каждой перезагрузке
+	};
+	using SlotTable = unordered_map<string, Slot*>;
+
+	//static означает, что эти переменные общие для всех объектов класса.
+	static atomic<const SlotTable*> slots;       // неизменяемая таблица id -> слот, при новом id копируется целиком
+	static mutex writeMutex;                     // только для добавления id и каталога шрифтов
+	static vector<unique_ptr<Slot>> slotStorage;
+	static vector<unique_ptr<const SlotTable>> tableStorage; // старые таблицы живут до конца программы: читатели могут их держать
+	static string fontDir;      // каталог внешних шрифтов, которые перекрывают встроенные ("" - не задан)
+	static bool fontDirResolved;
+	static atomic<int> loads;
+	static atomic<int> reloads;
+	static atomic<int> pinning;                  // сколько ReadGuard сейчас между чтением снимка и pins++
+	static vector<unique_ptr<const Snapshot>> retired; // замененные снимки ждут, пока их не отпустят все guard (под writeMutex)
+
+	static void reclaimLocked() {
+		// seq_cst в паре с pin: если pinning 0, новый guard уже увидит новый снимок, а у старых pins больше не растет
+		if (retired.empty() || pinning.load() != 0) return;
+		retired.erase(remove_if(retired.begin(), retired.end(), [](const unique_ptr<const Snapshot>& snapshot) {
+			return snapshot->pins.load() == 0;
+		}), retired.end());
 	}
 
-	void print(const string& text) const {
-		printStatic(text, color, position, symbol, fontId);
+	static const Snapshot& currentSnapshot(const string& fontId) {
+		if (Slot* slot = findSlot(fontId)) {
+			if (const Snapshot* snapshot = slot->current.load()) return *snapshot;
+		}
+		loadFont(fontId);
+		return *findSlot(fontId)->current.load();
 	}
 
-	~Printer() {
-		// Восстановление состояния консоли
-		cout << ANSICodes::resetColor();
+	static const Snapshot* pin(const string& fontId) {
+		pinning.fetch_add(1); // пока счетчик не 0, reclaim ничего не освобождает: снимок не пропадет между load и pins++
+		const Snapshot* snapshot = &currentSnapshot(fontId);
+		snapshot->pins.fetch_add(1);
+		pinning.fetch_sub(1);
+		return snapshot;
+	}
+
+	static Slot* findSlot(const string& fontId) {
+		const SlotTable* table = slots.load(memory_order_acquire);
+		if (table == nullptr) return nullptr;
+		auto it = table->find(fontId);
+		return it == table->end() ? nullptr : it->second;
+	}
+
+	static Slot& slotFor(const string& fontId) {
+		if (Slot* slot = findSlot(fontId)) return *slot;
+
+		lock_guard<mutex> lock(writeMutex);
+		const SlotTable* current = slots.load(memory_order_acquire);
+		if (current != nullptr) {
+			auto it = current->find(fontId);
+			if (it != current->end()) return *it->second; // успели добавить, пока ждали мьютекс
+		}
+		auto next = make_unique<SlotTable>(current ? *current : SlotTable{});
+		slotStorage.push_back(make_unique<Slot>());
+		Slot* slot = slotStorage.back().get();
+		(*next)[fontId] = slot;
+		slots.store(next.get(), memory_order_release);
+		tableStorage.push_back(move(next));
+		return *slot;
+	}
+
+	static bool loadExternal(const string& fontId, const string& dir, FontTemplates& font, KerningTable& kerning) {
+		if (CompiledFont::load(fontId, font, kerning, dir)) { // актуальный .fnt - без разбора текста
+			return true;
+		}
+
+		ifstream file(CompiledFont::textPath(fontId, dir));
+		if (!file.is_open()) {
+			return false;
+		}
+		font = parseFontText(file, &kerning);
+		file.close();
+		return true;
+	}
+
+	static bool loadBuiltin(const string& fontId, FontTemplates& font, KerningTable& kerning) {
+		for (const BuiltinFont& builtin : builtin_fonts::fonts) {
+			if (builtin.glyphs == nullptr || fontId != builtin.id) continue;
+			for (size_t g = 0; g < builtin.count; g++) {
+				const BuiltinGlyph& glyph = builtin.glyphs[g];
+				font[glyph.key] = vector<string>(glyph.lines, glyph.lines + glyph.rows);
+			}
+			for (size_t k = 0; k < builtin.kerningCount; k++) {
+				kerning[{builtin.kerning[k].left, builtin.kerning[k].right}] = builtin.kerning[k].adjust;
+			}
+			return true;
+		}
+		return false;
+	}
+
+	static Font readFont(const string& fontId) {
+		KerningTable kerning;
+		FontTemplates templates = readTemplates(fontId, &kerning);
+		return Font::fromTemplates(templates, kerning);
+	}
+
+public:
+	// закрепляет текущий снимок шрифта: пока guard жив, снимок не освобождается, даже если его заменила перезагрузка.
+	// Счетчик у каждого снимка свой, так что долгоживущий guard не держит остальные замененные снимки. Без блокировок
+	class ReadGuard {
+	private:
+		const Snapshot* snapshot;
+
+	public:
+		explicit ReadGuard(const string& fontId) : snapshot(pin(fontId)) {}
+		ReadGuard(const ReadGuard& other) : snapshot(other.snapshot) { snapshot->pins.fetch_add(1); }
+		ReadGuard& operator=(const ReadGuard& other) {
+			other.snapshot->pins.fetch_add(1);
+			snapshot->pins.fetch_sub(1);
+			snapshot = other.snapshot;
+			return *this;
+		}
+		~ReadGuard() { snapshot->pins.fetch_sub(1); }
+
+		const Font& font() const { return snapshot->font; }
+	};
+
+	// шаблоны шрифта в виде map, без кэширования (для генераторов и сравнения в бенчмарках)
+	static FontTemplates readTemplates(const string& fontId, KerningTable* kerningOut = nullptr) {
+		const string dir = fontDirectory();
+		FontTemplates font;
+		KerningTable kerning;
+		bool ok = (!dir.empty() && loadExternal(fontId, dir, font, kerning)) // внешний файл перекрывает встроенный шрифт
+			|| loadBuiltin(fontId, font, kerning)                             // без файлового ввода-вывода
+			|| (dir.empty() && loadExternal(fontId, ".", font, kerning));     // неизвестный id ищем в текущем каталоге, как раньше
+		if (!ok) {
+			cerr << "Ошибка загрузки файла шрифта: " << CompiledFont::textPath(fontId, dir.empty() ? "." : dir) << endl;
+			font.clear(); // empty map for this ID 
+			kerning.clear();
+		}
+		if (kerningOut != nullptr) *kerningOut = move(kerning);
+		return font;
+	}
+
+	static void setFontDirectory(const string& dir) { // влияет на шрифты, которые еще не загружены
+		lock_guard<mutex> lock(writeMutex);
+		fontDir = dir;
+		fontDirResolved = true;
+	}
+
+	static string fontDirectory() { // по умолчанию берется из переменной окружения BANNER_FONT_DIR
+		lock_guard<mutex> lock(writeMutex);
+		if (!fontDirResolved) {
+			const char* env = getenv("BANNER_FONT_DIR");
+			fontDir = env ? env : "";
+			fontDirResolved = true;
+		}
+		return fontDir;
+	}
+
+	static void loadFont(const string& fontId) { //static method can be used without creating object:) 
+		Slot& slot = slotFor(fontId);
+		if (slot.current.load(memory_order_acquire) != nullptr) { // already loaded, leaving method
+			return;
+		}
+		call_once(slot.once, [&] {
+			loads.fetch_add(1, memory_order_relaxed);
+			slot.owner = make_unique<const Snapshot>(readFont(fontId));
+			slot.current.store(slot.owner.get(), memory_order_release);
+		});
+	}
+
+	static int loadCount() { return loads.load(memory_order_relaxed); } // сколько раз реально читали шрифты
+	static int reloadCount() { return reloads.load(memory_order_relaxed); }
+
+	// перечитывает уже загруженный шрифт в фоне и подменяет снимок; начатые отрисовки дорисовывают старым
+	static bool reload(const string& fontId) {
+		Slot* slot = findSlot(fontId);
+		if (slot == nullptr || slot->current.load() == nullptr) return false; // еще не загружался - прочитается при первом обращении
+		auto next = make_unique<const Snapshot>(readFont(fontId));
+		if (next->font.empty()) return false; // файл пропал или сохранен не до конца - остаемся на старом снимке
+
+		lock_guard<mutex> lock(writeMutex);
+		slot->current.store(next.get());
+		retired.push_back(move(slot->owner));
+		slot->owner = move(next);
+		slot->generation.fetch_add(1);
+		reloads.fetch_add(1, memory_order_relaxed);
+		reclaimLocked();
+		return true;
+	}
+
+	// освободить замененные снимки, которые ни одна отрисовка больше не держит
+	static void reclaim() {
+		lock_guard<mutex> lock(writeMutex);
+		reclaimLocked();
+	}
+
+	static size_t retiredCount() { // сколько замененных снимков еще держат guard
+		lock_guard<mutex> lock(writeMutex);
+		return retired.size();
+	}
+
+	static unsigned generation(const string& fontId) {
+		Slot* slot = findSlot(fontId);
+		return slot ? slot->generation.load(memory_order_acquire) : 0;
+	}
+
+	// без блокировок, если шрифт уже загружен; иначе загружает его (в таблицу ничего не вставляется на промахе).
+	// Если включена перезагрузка шрифтов, берите шрифт через ReadGuard::font(): эта ссылка живет до следующей перезагрузки
+	static const Font& getFont(const string& fontId) {   //return tBF by font id   
+		return currentSnapshot(fontId).font;
 	}
 };
 
+atomic<const FontLoader::SlotTable*> FontLoader::slots{nullptr}; // allocate memory for ts vars out of class
+mutex FontLoader::writeMutex;
+vector<unique_ptr<FontLoader::Slot>> FontLoader::slotStorage;
+vector<unique_ptr<const FontLoader::SlotTable>> FontLoader::tableStorage;
+string FontLoader::fontDir;
+bool FontLoader::fontDirResolved = false;
+atomic<int> FontLoader::loads{0};
+atomic<int> FontLoader::reloads{0};
+atomic<int> FontLoader::pinning{0};
+vector<unique_ptr<const FontLoader::Snapshot>> FontLoader::retired;
 
+// следит за каталогом шрифтов и в фоне перезагружает измененные textN.txt / textN.fnt.
+// На Linux - inotify, в остальных системах - опрос времени изменения файлов
+class FontWatcher {
+private:
+	string dir;
+	atomic<bool> stopping{false};
+	thread worker;
+
+	static string fontIdOf(const string& fileName) { // "text1.txt" -> "1"
+		if (fileName.size() < 9 || fileName.compare(0, 4, "text") != 0) return "";
+		const string extension = fileName.substr(fileName.size() - 4);
+		if (extension != ".txt" && extension != ".fnt") return "";
+		return fileName.substr(4, fileName.size() - 8);
+	}
+
+	static void reloadAll(vector<string>& ids) {
+		for (const string& id : ids) FontLoader::reload(id);
+		ids.clear();
+	}
+
+#ifdef __linux__
+	void watchLoop() {
+		int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if (fd < 0 || inotify_add_watch(fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) < 0) {
+			cerr << "Не удалось следить за каталогом шрифтов: " << dir << endl;
+			if (fd >= 0) close(fd);
+			return;
+		}
+		alignas(inotify_event) char buffer[4096];
+		vector<string> pending;
+		while (!stopping.load()) {
+			pollfd request{fd, POLLIN, 0};
+			if (poll(&request, 1, pending.empty() ? 200 : 50) > 0) {
+				ssize_t got;
+				while ((got = read(fd, buffer, sizeof buffer)) > 0) {
+					for (char* next = buffer; next < buffer + got;) {
+						const inotify_event* event = reinterpret_cast<const inotify_event*>(next);
+						const string id = event->len ? fontIdOf(event->name) : "";
+						if (!id.empty() && find(pending.begin(), pending.end(), id) == pending.end()) pending.push_back(id);
+						next += sizeof(inotify_event) + event->len;
+					}
+				}
+				continue; // редактор может писать файл в несколько приемов: перечитываем после 50 мс тишины
+			}
+			reloadAll(pending);
+			FontLoader::reclaim();
+		}
+		close(fd);
+	}
+#else
+	void watchLoop() {
+		map<string, filesystem::file_time_type> stamps;
+		vector<string> changed;
+		while (!stopping.load()) {
+			error_code ec;
+			for (const auto& entry : filesystem::directory_iterator(dir, ec)) {
+				const string id = fontIdOf(entry.path().filename().string());
+				if (id.empty()) continue;
+				auto time = filesystem::last_write_time(entry.path(), ec);
+				auto it = stamps.find(entry.path().string());
+				if (it == stamps.end()) {
+					stamps.emplace(entry.path().string(), time);
+				} else if (it->second != time) {
+					it->second = time;
+					if (find(changed.begin(), changed.end(), id) == changed.end()) changed.push_back(id);
+				}
+			}
+			reloadAll(changed);
+			FontLoader::reclaim();
+			this_thread::sleep_for(chrono::milliseconds(250));
+		}
+	}
+#endif
+
+public:
+	// без каталога берется BANNER_FONT_DIR или текущий; он становится каталогом шрифтов FontLoader,
+	// чтобы перезагрузка читала файлы, а не встроенные шрифты
+	explicit FontWatcher(const string& directory = "") : dir(directory) {
+		if (dir.empty()) dir = FontLoader::fontDirectory();
+		if (dir.empty()) dir = ".";
+		FontLoader::setFontDirectory(dir);
+		worker = thread([this] { watchLoop(); });
+	}
+
+	FontWatcher(const FontWatcher&) = delete;
+	FontWatcher& operator=(const FontWatcher&) = delete;
+
+	~FontWatcher() {
+		stopping.store(true);
+		worker.join();
+	}
+
+	const string& directory() const { return dir; }
+};
+
+// retained-mode экран: сетка ячеек, кадр сравнивается с предыдущим и выводятся только изменения
+struct Cell {
+	char ch = ' ';        // символ ячейки, ' ' - пусто
+	uint8_t symbol = 0;   // 0 - выводим ch, иначе индекс в ScreenBuffer::symbols (UTF-8 символ)
+	Paint color = Color::RESET;
+
+	bool operator==(const Cell& other) const {
+		return ch == other.ch && symbol == other.symbol && (ch == ' ' || color == other.color); // цвет пробела не важен
+	}
+	bool operator!=(const Cell& other) const { return !(*this == other); }
+};
+
+class ScreenBuffer {
+public:
+	struct FrameStats {
+		size_t bytesEmitted = 0;     // сколько реально записали в терминал
+		size_t fullRedrawBytes = 0;  // сколько стоила бы полная перерисовка с clearScreen
+		size_t changedCells = 0;
+		size_t bytesSaved() const { return fullRedrawBytes > bytesEmitted ? fullRedrawBytes - bytesEmitted : 0; }
+	};
+
+private:
+	int rows = 0, cols = 0;
+	vector<Cell> front; // то, что сейчас на экране
+	vector<Cell> back;  // кадр, который рисуем
+	vector<string> symbols{""};
+	bool paletteOverflow = false;
+	bool firstFrame = true;
+	FrameStats stats;
+
+	const string& cellText(const Cell& cell, string& tmp) const {
+		if (cell.ch != ' ' && cell.symbol != 0) return symbols[cell.symbol];
+		tmp.assign(1, cell.ch);
+		return tmp;
+	}
+
+	// полная перерисовка: clearScreen + каждая непустая строка целиком со сменой цвета на строке
+	size_t fullRedrawSize() const {
+		size_t bytes = ANSICodes::clearScreen().size();
+		string tmp;
+		for (int r = 0; r < rows; r++) {
+			int last = cols - 1;
+			while (last >= 0 && back[r * cols + last].ch == ' ') last--;
+			if (last < 0) continue;
+			bytes += ANSICodes::moveCursor(r + 1, 1).size();
+			Paint current = Color::RESET;
+			for (int c = 0; c <= last; c++) {
+				const Cell& cell = back[r * cols + c];
+				if (cell.ch != ' ' && cell.color != current) {
+					bytes += ANSICodes::colorLength(cell.color);
+					current = cell.color;
+				}
+				bytes += cellText(cell, tmp).size();
+			}
+			bytes += ANSICodes::resetColor().size();
+		}
+		return bytes;
+	}
+
+public:
+	void resize(int newRows, int newCols) { // содержимое сохраняется, новые ячейки считаются пустыми на экране
+		if (newRows <= rows && newCols <= cols) return;
+		newRows = max(newRows, rows);
+		newCols = max(newCols, cols);
+		vector<Cell> newFront(newRows * newCols), newBack(newRows * newCols);
+		for (int r = 0; r < rows; r++) {
+			for (int c = 0; c < cols; c++) {
+				newFront[r * newCols + c] = front[r * cols + c];
+				newBack[r * newCols + c] = back[r * cols + c];
+			}
+		}
+		rows = newRows;
+		cols = newCols;
+		front.swap(newFront);
+		back.swap(newBack);
+	}
+
+	int height() const { return rows; }
+	int width() const { return cols; }
+	const Cell& cell(int row, int col) const { return back[row * cols + col]; } // ячейка заднего буфера
+	const string& symbolText(uint8_t symbol) const { return symbols[symbol]; }
+
+	void clear() { // очищаем только задний буфер
+		fill(back.begin(), back.end(), Cell{});
+	}
+
+	// в палитре до 255 символов; при переполнении возвращается 0 - ячейка выводится символом шаблона (Cell::ch),
+	// а не чужим символом, и один раз печатается предупреждение
+	uint8_t internSymbol(const string& symbol) {
+		for (size_t i = 1; i < symbols.size(); i++) {
+			if (symbols[i] == symbol) return static_cast<uint8_t>(i);
+		}
+		if (symbols.size() == 256) {
+			if (!paletteOverflow) cerr << "Палитра символов экрана заполнена (255), символ \"" << symbol << "\" выводится как в шаблоне\n";
+			paletteOverflow = true;
+			return 0;
+		}
+		symbols.push_back(symbol);
+		return static_cast<uint8_t>(symbols.size() - 1);
+	}
+
+	void put(int row, int col, char ch, uint8_t symbol, Paint color) { // row, col 0-based
+		if (row < 0 || col < 0) return;
+		resize(row + 1, col + 1);
+		back[row * cols + col] = Cell{ch, symbol, color};
+	}
+
+	// перекрасить закрашенные ячейки прямоугольника градиентом (по его столбцам или строкам)
+	void applyGradient(int top, int left, int height, int width, const Gradient& gradient) {
+		const bool byColumns = gradient.direction == Gradient::Direction::COLUMNS;
+		vector<Paint> steps(max(0, byColumns ? width : height));
+		for (size_t i = 0; i < steps.size(); i++) steps[i] = gradient.at(static_cast<int>(i), static_cast<int>(steps.size()));
+		for (int r = max(0, top); r < min(rows, top + height); r++) {
+			for (int c = max(0, left); c < min(cols, left + width); c++) {
+				Cell& cell = back[r * cols + c];
+				if (cell.ch != ' ') cell.color = steps[byColumns ? c - left : r - top];
+			}
+		}
+	}
+
+	// сравниваем задний буфер с передним и возвращаем минимальный поток байт для терминала
+	string present() {
+		string out;
+		stats = FrameStats{};
+		stats.fullRedrawBytes = fullRedrawSize();
+		if (firstFrame) { // что сейчас в терминале неизвестно - очищаем один раз
+			out += ANSICodes::clearScreen();
+			fill(front.begin(), front.end(), Cell{});
+			firstFrame = false;
+		}
+
+		string tmp;
+		Paint current = Color::RESET;
+		bool colored = false;
+		int cursorRow = -1, cursorCol = -1;
+		for (int r = 0; r < rows; r++) {
+			for (int c = 0; c < cols; c++) {
+				const Cell& cell = back[r * cols + c];
+				if (cell == front[r * cols + c]) continue;
+				stats.changedCells++;
+
+				if (cursorRow != r || cursorCol != c) {
+					// короткий разрыв дешевле заполнить пробелами/символами, чем двигать курсор
+					int gap = c - cursorCol;
+					bool bridged = false;
+					if (cursorRow == r && gap > 0 && gap <= 3) {
+						bridged = true;
+						for (int g = cursorCol; g < c; g++) {
+							const Cell& skip = back[r * cols + g];
+							if (skip.ch != ' ' && (!colored || skip.color != current)) { bridged = false; break; }
+						}
+						if (bridged) {
+							for (int g = cursorCol; g < c; g++) out += cellText(back[r * cols + g], tmp);
+						}
+					}
+					if (!bridged) out += ANSICodes::moveCursor(r + 1, c + 1);
+				}
+				if (cell.ch != ' ' && (!colored || cell.color != current)) { // цвет меняем только на границе серии
+					ANSICodes::appendColor(out, cell.color);
+					current = cell.color;
+					colored = true;
+				}
+				out += cellText(cell, tmp);
+				cursorRow = r;
+				cursorCol = c + 1;
+			}
+		}
+		if (colored) out += ANSICodes::resetColor();
+
+		front = back;
+		stats.bytesEmitted = out.size();
+		return out;
+	}
+
+	const FrameStats& lastStats() const { return stats; }
+};
+
+enum class Align { LEFT, CENTER, RIGHT };
+
+struct LayoutOptions {
+	int maxWidth = 0;       // ширина в ячейках для переноса по словам, 0 - без переноса
+	Align align = Align::LEFT;
+	int tabSize = 4;        // табуляция до позиции, кратной tabSize символам
+	int letterSpacing = 1;  // пустых ячеек между глифами
+	int lineSpacing = 1;    // пустых строк ячеек между строками текста
+};
+
+// раскладка текста: переносы строк, выравнивание, кернинг и табуляция считаются один раз в конструкторе,
+// потом раскладку можно рисовать сколько угодно раз в разных местах и разными цветами
+class TextLayout {
+public:
+	struct PlacedGlyph {
+		const Font::Glyph* glyph;
+		int x;  // левая верхняя ячейка глифа относительно начала раскладки
+		int y;
+	};
+
+private:
+	FontLoader::ReadGuard guard; // раскладка хранит указатели на глифы своего снимка шрифта
+	const Font* font;
+	vector<PlacedGlyph> placed;  // только глифы с рисунком, пробелы не хранятся
+	int totalWidth = 0;
+	int totalHeight = 0;
+
+	struct LineGlyph {
+		char32_t c;
+		int x;
+	};
+
+public:
+	TextLayout(const string& text, const string& fontId = "1", const LayoutOptions& options = {})
+		: guard(fontId), font(&guard.font()) {
+		const int spacing = max(0, options.letterSpacing);
+		const int tabStop = max(1, options.tabSize) * (font->defaultWidth() + spacing);
+
+		vector<char32_t> codes; // текст декодируется один раз, дальше работаем с кодами символов
+		codes.reserve(text.size());
+		forEachCodePoint(text, [&](char32_t cp) { codes.push_back(cp); });
+		auto isSpace = [](char32_t c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f'; };
+
+		vector<vector<LineGlyph>> lines(1);
+		int x = 0;
+		char32_t prev = 0;
+		auto newLine = [&] {
+			lines.emplace_back();
+			x = 0;
+			prev = 0;
+		};
+		auto advance = [&](char32_t c) { // позиция глифа c, если поставить его сейчас; кернинг не уводит левее начала строки
+			return (prev != 0 && !lines.back().empty()) ? max(0, x + font->kerning(prev, c)) : x;
+		};
+		auto place = [&](char32_t c) {
+			int at = advance(c);
+			lines.back().push_back({c, at});
+			x = at + font->glyph(c).width + spacing;
+			prev = c;
+		};
+
+		size_t i = 0;
+		while (i < codes.size()) {
+			const char32_t c = codes[i];
+			if (c == '\r') { i++; continue; }
+			if (c == '\n') { newLine(); i++; continue; }
+			if (c == '\t') {
+				x = (x / tabStop + 1) * tabStop;
+				prev = 0;
+				i++;
+				continue;
+			}
+			if (c == ' ') {
+				if (!(options.maxWidth > 0 && lines.size() > 1 && lines.back().empty() && x == 0)) place(c); // пробелы в начале перенесенной строки не нужны
+				i++;
+				continue;
+			}
+
+			// слово целиком: если не помещается в строку, переносим его на новую
+			size_t end = i;
+			while (end < codes.size() && !isSpace(codes[end])) end++;
+			if (options.maxWidth > 0 && x > 0) {
+				int wordEnd = x;
+				char32_t wordPrev = prev;
+				for (size_t j = i; j < end; j++) {
+					const char32_t wc = codes[j];
+					if (wordPrev != 0) wordEnd = max(0, wordEnd + font->kerning(wordPrev, wc));
+					wordEnd += font->glyph(wc).width + (j + 1 < end ? spacing : 0);
+					wordPrev = wc;
+				}
+				if (wordEnd > options.maxWidth) newLine();
+			}
+			for (; i < end; i++) {
+				const char32_t wc = codes[i];
+				if (options.maxWidth > 0 && x > 0 && advance(wc) + font->glyph(wc).width > options.maxWidth) {
+					newLine(); // слово длиннее строки - переносим по символам
+				}
+				place(wc);
+			}
+		}
+
+		// ширина строки - до правого края последнего глифа с рисунком, хвостовые пробелы не считаются
+		vector<int> lineWidths;
+		for (const auto& line : lines) {
+			int width = 0;
+			for (const LineGlyph& g : line) {
+				if (!font->isBlank(g.c)) width = max(width, g.x + font->glyph(g.c).width);
+			}
+			lineWidths.push_back(width);
+			totalWidth = max(totalWidth, width);
+		}
+		if (options.maxWidth > 0 && options.align != Align::LEFT) totalWidth = max(totalWidth, options.maxWidth);
+
+		const int lineHeight = font->height() + max(0, options.lineSpacing);
+		for (size_t l = 0; l < lines.size(); l++) {
+			int offset = 0;
+			if (options.align == Align::RIGHT) offset = totalWidth - lineWidths[l];
+			if (options.align == Align::CENTER) offset = (totalWidth - lineWidths[l]) / 2;
+			for (const LineGlyph& g : lines[l]) {
+				if (font->isBlank(g.c)) continue;
+				placed.push_back({&font->glyph(g.c), offset + g.x, static_cast<int>(l) * lineHeight});
+			}
+		}
+		totalHeight = static_cast<int>(lines.size()) * lineHeight - max(0, options.lineSpacing);
+	}
+
+	int width() const { return totalWidth; }
+	int height() const { return totalHeight; }
+	int glyphHeight() const { return font->height(); }
+	const vector<PlacedGlyph>& glyphs() const { return placed; }
+
+	// рисуем в буфер экрана с левого верхнего угла (top, left), 0-based; перекрывающиеся глифы объединяются
+	void draw(ScreenBuffer& screen, int top, int left, uint8_t symbol, Paint color) const {
+		if (totalHeight > 0 && totalWidth > 0) screen.resize(top + totalHeight, left + totalWidth);
+		for (const PlacedGlyph& g : placed) {
+			for (int r = 0; r < font->height(); r++) {
+				const char* row = font->row(*g.glyph, r);
+				for (int c = 0; c < g.glyph->width; c++) {
+					if (row[c] != ' ') screen.put(top + g.y + r, left + g.x + c, row[c], symbol, color);
+				}
+			}
+		}
+	}
+
+	// строки ячеек, как Printer::composeRows (не-пробел - закрашенная ячейка)
+	vector<string> rows() const {
+		vector<string> out(max(0, totalHeight), string(max(0, totalWidth), ' '));
+		for (const PlacedGlyph& g : placed) {
+			for (int r = 0; r < font->height(); r++) {
+				const char* row = font->row(*g.glyph, r);
+				for (int c = 0; c < g.glyph->width; c++) {
+					if (row[c] != ' ') out[g.y + r][g.x + c] = row[c];
+				}
+			}
+		}
+		return out;
+	}
+};
+
+// LRU-кэш готовых кадров printStatic (вместе с escape-последовательностями) по (текст, шрифт, цвет, символ).
+// Кадр не зависит от позиции, поэтому попадание - один поиск в хэш-таблице и одна запись в поток
+class RenderCache {
+public:
+	struct Stats {
+		size_t hits = 0;
+		size_t misses = 0;
+		size_t evictions = 0;
+		size_t entries = 0;
+		size_t bytes = 0;
+	};
+
+private:
+	struct Entry {
+		string text;
+		string fontId;
+		string symbol;
+		Paint color;
+		unsigned generation;      // снимок шрифта, которым нарисован кадр
+		shared_ptr<const string> frame;
+		size_t bytes;
+	};
+
+	size_t budget;
+	mutable mutex m;
+	list<Entry> lru;                                      // в начале - недавно использованные
+	unordered_map<uint64_t, list<Entry>::iterator> index; // ключ - хэш полей, поля сверяются в записи
+	Stats stats;
+
+	static uint64_t hashKey(const string& text, Paint color, const string& symbol, const string& fontId) {
+		uint64_t h = std::hash<string>{}(text);
+		h = h * 0x9E3779B97F4A7C15ull ^ std::hash<string>{}(symbol);
+		h = h * 0x9E3779B97F4A7C15ull ^ std::hash<string>{}(fontId);
+		return h * 0x9E3779B97F4A7C15ull ^ color.raw();
+	}
+
+	void evictTo(size_t limit) {
+		while (stats.bytes > limit && !lru.empty()) {
+			const Entry& victim = lru.back();
+			index.erase(hashKey(victim.text, victim.color, victim.symbol, victim.fontId));
+			stats.bytes -= victim.bytes;
+			lru.pop_back();
+			stats.evictions++;
+		}
+		stats.entries = lru.size();
+	}
+
+public:
+	explicit RenderCache(size_t budgetBytes) : budget(budgetBytes) {}
+
+	// nullptr - промах; кадр от старого снимка шрифта (до перезагрузки) тоже промах
+	shared_ptr<const string> find(const string& text, Paint color, const string& symbol, const string& fontId, unsigned generation = 0) {
+		lock_guard<mutex> lock(m);
+		auto it = index.find(hashKey(text, color, symbol, fontId));
+		if (it == index.end() || it->second->color != color || it->second->text != text || it->second->symbol != symbol ||
+			it->second->fontId != fontId || it->second->generation != generation) {
+			stats.misses++;
+			return nullptr;
+		}
+		lru.splice(lru.begin(), lru, it->second);
+		stats.hits++;
+		return it->second->frame;
+	}
+
+	void insert(const string& text, Paint color, const string& symbol, const string& fontId, shared_ptr<const string> frame,
+				unsigned generation = 0) {
+		const size_t bytes = frame->size() + text.size() + symbol.size() + fontId.size() + sizeof(Entry) + 64; // 64 - узлы списка и таблицы
+		if (bytes > budget) return; // кадр больше всего бюджета не кэшируем
+
+		lock_guard<mutex> lock(m);
+		const uint64_t key = hashKey(text, color, symbol, fontId);
+		auto it = index.find(key);
+		if (it != index.end()) { // тот же ключ (или коллизия хэша) - заменяем запись
+			stats.bytes -= it->second->bytes;
+			lru.erase(it->second);
+			index.erase(it);
+		}
+		lru.push_front(Entry{text, fontId, symbol, color, generation, move(frame), bytes});
+		index[key] = lru.begin();
+		stats.bytes += bytes;
+		evictTo(budget);
+	}
+
+	void setBudget(size_t budgetBytes) {
+		lock_guard<mutex> lock(m);
+		budget = budgetBytes;
+		evictTo(budget);
+	}
+
+	Stats snapshot() const {
+		lock_guard<mutex> lock(m);
+		return stats;
+	}
+};
+
+enum class ExportFormat { PPM, PNG, HTML };
+
+// вывод баннера не в терминал, а в файл: растровые PPM/PNG (ячейка - квадрат scale x scale пикселей) и HTML
+class BannerExporter {
+private:
+	static void putBigEndian(string& out, uint32_t v) {
+		out += static_cast<char>(v >> 24);
+		out += static_cast<char>(v >> 16);
+		out += static_cast<char>(v >> 8);
+		out += static_cast<char>(v);
+	}
+
+	static uint32_t crc32(const char* data, size_t size, uint32_t crc = 0) {
+		static const array<uint32_t, 256> table = [] {
+			array<uint32_t, 256> t{};
+			for (uint32_t n = 0; n < 256; n++) {
+				uint32_t c = n;
+				for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+				t[n] = c;
+			}
+			return t;
+		}();
+		crc = ~crc;
+		for (size_t i = 0; i < size; i++) crc = table[(crc ^ static_cast<unsigned char>(data[i])) & 0xFF] ^ (crc >> 8);
+		return ~crc;
+	}
+
+	static void pngChunk(string& png, const char* type, const string& data) {
+		putBigEndian(png, static_cast<uint32_t>(data.size()));
+		const size_t start = png.size();
+		png.append(type, 4);
+		png += data;
+		putBigEndian(png, crc32(png.data() + start, png.size() - start));
+	}
+
+	// RGB пиксели построчно; rowPrefix - сколько байт оставить в начале каждой строки (фильтр PNG)
+	static string rasterize(const vector<string>& rows, Paint color, Paint background, int scale, size_t rowPrefix,
+							int& width, int& height) {
+		scale = max(1, scale);
+		width = rows.empty() ? 0 : static_cast<int>(rows[0].size()) * scale;
+		height = static_cast<int>(rows.size()) * scale;
+		const uint32_t fg = color.toRgb(), bg = background.toRgb();
+		if (width == 0 || height == 0) { // пустой баннер - один пиксель фона: нулевые размеры PNG запрещает, а PPM многие не читают
+			width = height = 1;
+			string pixel(rowPrefix, '\0');
+			pixel += static_cast<char>(bg >> 16);
+			pixel += static_cast<char>(bg >> 8);
+			pixel += static_cast<char>(bg);
+			return pixel;
+		}
+		const size_t stride = rowPrefix + static_cast<size_t>(width) * 3;
+		string pixels(stride * height, '\0');
+		for (size_t r = 0; r < rows.size(); r++) {
+			char* line = &pixels[r * scale * stride];
+			char* px = line + rowPrefix;
+			for (char cell : rows[r]) {
+				const uint32_t rgb = cell != ' ' ? fg : bg;
+				for (int k = 0; k < scale; k++) {
+					*px++ = static_cast<char>(rgb >> 16);
+					*px++ = static_cast<char>(rgb >> 8);
+					*px++ = static_cast<char>(rgb);
+				}
+			}
+			for (int k = 1; k < scale; k++) memcpy(line + k * stride, line, stride); // строка ячеек повторяется scale раз
+		}
+		return pixels;
+	}
+
+public:
+	static string toPPM(const vector<string>& rows, Paint color, Paint background = Color::BLACK, int scale = 4) {
+		int width = 0, height = 0;
+		string pixels = rasterize(rows, color, background, scale, 0, width, height);
+		return "P6\n" + to_string(width) + " " + to_string(height) + "\n255\n" + pixels;
+	}
+
+	// PNG без сжатия: deflate из "stored" блоков, чтобы не зависеть от zlib
+	static string toPNG(const vector<string>& rows, Paint color, Paint background = Color::BLACK, int scale = 4) {
+		int width = 0, height = 0;
+		const string raw = rasterize(rows, color, background, scale, 1, width, height); // байт фильтра 0 уже на месте
+
+		string png("\x89PNG\r\n\x1a\n", 8);
+		string header;
+		putBigEndian(header, static_cast<uint32_t>(width));
+		putBigEndian(header, static_cast<uint32_t>(height));
+		header += string("\x08\x02\x00\x00\x00", 5); // 8 бит, RGB, без interlace
+		pngChunk(png, "IHDR", header);
+		if (rows.empty() || rows[0].empty()) { // пиксель пустого баннера делаем прозрачным: цвет фона в tRNS
+			const uint32_t bg = background.toRgb();
+			string transparent;
+			for (int shift = 16; shift >= 0; shift -= 8) {
+				transparent += '\0';
+				transparent += static_cast<char>(bg >> shift);
+			}
+			pngChunk(png, "tRNS", transparent);
+		}
+
+		string zlib("\x78\x01", 2);
+		zlib.reserve(raw.size() + raw.size() / 65535 * 5 + 16);
+		size_t pos = 0;
+		do {
+			const size_t block = min<size_t>(65535, raw.size() - pos);
+			const bool last = pos + block == raw.size();
+			zlib += static_cast<char>(last ? 1 : 0);
+			zlib += static_cast<char>(block & 0xFF);
+			zlib += static_cast<char>(block >> 8);
+			zlib += static_cast<char>(~block & 0xFF);
+			zlib += static_cast<char>((~block >> 8) & 0xFF);
+			zlib.append(raw, pos, block);
+			pos += block;
+		} while (pos < raw.size());
+		uint32_t a = 1, b = 0; // adler32, остаток берется раз в 5552 байта - раньше 32 бита не переполнятся
+		for (size_t i = 0; i < raw.size();) {
+			const size_t end = min(raw.size(), i + 5552);
+			for (; i < end; i++) {
+				a += static_cast<unsigned char>(raw[i]);
+				b += a;
+			}
+			a %= 65521;
+			b %= 65521;
+		}
+		putBigEndian(zlib, b << 16 | a);
+		pngChunk(png, "IDAT", zlib);
+		pngChunk(png, "IEND", "");
+		return png;
+	}
+
+	// <pre> с одним <span> цвета на строку
+	static string toHTML(const vector<string>& rows, Paint color, const string& symbol = "*") {
+		const uint32_t rgb = color.toRgb();
+		char hex[8];
+		snprintf(hex, sizeof(hex), "#%06x", static_cast<unsigned>(rgb));
+		string escaped;
+		for (char ch : symbol.empty() ? string("*") : symbol) {
+			switch (ch) {
+			case '<': escaped += "&lt;"; break;
+			case '>': escaped += "&gt;"; break;
+			case '&': escaped += "&amp;"; break;
+			case '"': escaped += "&quot;"; break;
+			default: escaped += ch;
+			}
+		}
+		string html = "<pre class=\"banner\">";
+		for (const string& row : rows) {
+			html += "<span style=\"color:";
+			html += hex;
+			html += "\">";
+			for (char cell : row) {
+				if (cell != ' ') {
+					html += escaped;
+				} else {
+					html += ' ';
+				}
+			}
+			html += "</span>\n";
+		}
+		html += "</pre>\n";
+		return html;
+	}
+
+	static const char* extension(ExportFormat format) {
+		switch (format) {
+		case ExportFormat::PPM: return "ppm";
+		case ExportFormat::PNG: return "png";
+		default: return "html";
+		}
+	}
+};
+
+class Printer {
+private:
+	Paint color;
+	optional<Gradient> gradient; // если задан, перекрашивает баннер вместо color
+	pair<int, int> position; // {row, col}, 1-based
+	string fontId;
+	string symbol;
+	ScreenBuffer screen;     // последний выведенный кадр этого принтера
+	static shared_ptr<RenderCache> cache; // кэш кадров printStatic, по умолчанию выключен
+	static mutex cacheMutex;              // защищает сам указатель cache: включение и выключение из любого потока
+
+	static shared_ptr<RenderCache> activeCache() {
+		lock_guard<mutex> lock(cacheMutex);
+		return cache;
+	}
+
+public:
+	// строки баннера из шаблонов шрифта (не-пробел - закрашенная ячейка), без подстановки символа
+	static vector<string> composeRows(const string& text, const string& fontId) {
+		FontLoader::ReadGuard guard(fontId);
+		const Font& font = guard.font();
+		if (font.empty()) {
+			reportEmptyFont(fontId);
+			return {};
+		}
+
+		const int height = font.height();
+		vector<string> outputLines(height, "");
+		for (string& line : outputLines) line.reserve(text.size() * 8);
+
+		forEachCodePoint(text, [&](char32_t cp) {
+			const Font::Glyph& glyph = font.glyph(cp); // одно обращение по индексу
+			for (int i = 0; i < height; i++) {
+				outputLines[i].append(font.row(glyph, i), glyph.width).push_back(' ');
+			}
+		});
+		return outputLines;
+	}
+
+	static void reportEmptyFont(const string& fontId) {
+		#ifdef _WIN32
+			SetConsoleOutputCP(65001);
+		#endif
+		cerr << "Шрифт не загружен или пуст: " << fontId << endl;
+	}
+
+	// ячейки шаблона -> текст: не-пробел заменяется UTF-8 символом (пустой символ -> "*")
+	static void appendSymbols(string& out, const char* cells, size_t count, const string& symbol) {
+		const string& actualSymbol = symbol.empty() ? defaultSymbol() : symbol;
+		if (actualSymbol.size() == 1) { // однобайтовый символ - копируем строку целиком и заменяем на месте
+			const size_t start = out.size();
+			out.append(cells, count);
+			for (size_t j = start; j < out.size(); j++) {
+				if (out[j] != ' ') out[j] = actualSymbol[0];
+			}
+			return;
+		}
+		out.reserve(out.size() + count * actualSymbol.size());
+		for (size_t j = 0; j < count; j++) {
+			if (cells[j] != ' ') {
+				out += actualSymbol;
+			} else {
+				out += ' ';
+			}
+		}
+	}
+
+	static const string& defaultSymbol() {
+		static const string star = "*";
+		return star;
+	}
+
+	// static output
+	static void printStatic(const string& text,
+							Paint color,
+							const pair<int, int>& position,
+							const string& symbol = "*",
+							const string& fontId = "1") {
+		FontLoader::loadFont(fontId);
+		const unsigned generation = FontLoader::generation(fontId); // до отрисовки: кадр не новее этого снимка
+		const shared_ptr<RenderCache> active = activeCache(); // кэш не исчезнет, даже если его выключат во время вывода
+		shared_ptr<const string> frame = active ? active->find(text, color, symbol, fontId, generation) : nullptr;
+		if (!frame) {
+			frame = make_shared<const string>(renderFrame(text, color, symbol, fontId));
+			if (frame->empty()) return;
+			if (active) active->insert(text, color, symbol, fontId, frame, generation);
+		}
+		writePlaced(cout, *frame, position);
+	}
+
+	// Очистка экрана, вертикальное смещение переводами строк и горизонтальное - пробелами перед каждой строкой кадра
+	// (переводы строк, а не перемещение курсора: у нижнего края экрана терминал прокручивает вывод)
+	static void writePlaced(ostream& out, const string& frame, const pair<int, int>& position) {
+		out << ANSICodes::clearScreen();
+		for (int i = 0; i < max(0, position.first - 1); i++) {
+			out.put('\n');
+		}
+		const int indent = max(0, position.second - 1);
+		if (indent == 0) {
+			out.write(frame.data(), static_cast<streamsize>(frame.size()));
+			return;
+		}
+		for (size_t begin = 0; begin < frame.size();) {
+			size_t end = frame.find('\n', begin);
+			end = end == string::npos ? frame.size() : end + 1;
+			for (int i = 0; i < indent; i++) {
+				out.put(' ');
+			}
+			out.write(frame.data() + begin, static_cast<streamsize>(end - begin));
+			begin = end;
+		}
+	}
+
+	// кадр printStatic без позиции: каждая строка с цветом и сбросом цвета, заканчивается '\n'
+	// строки раскрываются прямо из битовых масок глифов через SymbolExpander, без промежуточных строк ячеек
+	static string renderFrame(const string& text, Paint color, const string& symbol = "*", const string& fontId = "1") {
+		FontLoader::ReadGuard guard(fontId);
+		const Font& font = guard.font();
+		if (font.empty()) {
+			reportEmptyFont(fontId);
+			return {};
+		}
+		const SymbolExpander& expander = SymbolExpander::forSymbol(symbol);
+		vector<const Font::Glyph*> glyphs;
+		glyphs.reserve(text.size());
+		size_t rowCells = 0;
+		forEachCodePoint(text, [&](char32_t cp) {
+			glyphs.push_back(&font.glyph(cp));
+			rowCells += glyphs.back()->width + 1;
+		});
+
+		string frame;
+		const size_t rowBytes = rowCells * expander.symbolSize() + expander.slack();
+		for (int i = 0; i < font.height(); i++) {
+			ANSICodes::appendColor(frame, color);
+			const size_t begin = frame.size();
+			frame.resize(begin + rowBytes);
+			char* out = &frame[begin];
+			for (const Font::Glyph* glyph : glyphs) { // Replace non-space characters with UTF-8 symbol
+				out = expander.expand(out, font.mask(*glyph, i), glyph->width);
+				*out++ = ' ';
+			}
+			frame.resize(static_cast<size_t>(out - frame.data()));
+			frame += ANSICodes::resetColor();
+			frame += '\n';
+		}
+		return frame;
+	}
+
+	// серии градиента: соседние столбцы (строки) одного цвета объединены, последовательность цвета каждой серии готова
+	struct GradientRuns {
+		struct Run {
+			int start;            // первый столбец (строка) серии
+			uint32_t sequence;    // смещение последовательности цвета в sequences
+			uint32_t length;
+		};
+		Gradient gradient;
+		int steps = -1;
+		string sequences;
+		vector<Run> runs;
+	};
+
+	// серии считаются один раз на градиент и ширину (высоту) кадра: кадры подряд обычно одинаковые
+	static const GradientRuns& gradientRuns(const Gradient& gradient, int steps) {
+		thread_local GradientRuns last;
+		if (last.steps == steps && last.gradient.from == gradient.from && last.gradient.to == gradient.to &&
+			last.gradient.direction == gradient.direction) {
+			return last;
+		}
+		last.gradient = gradient;
+		last.steps = steps;
+		last.sequences.clear();
+		last.runs.clear();
+		Paint previous;
+		for (int i = 0; i < steps; i++) {
+			Paint paint = gradient.at(i, steps);
+			if (!last.runs.empty() && paint == previous) continue;
+			const uint32_t offset = static_cast<uint32_t>(last.sequences.size());
+			ANSICodes::appendColor(last.sequences, paint);
+			last.runs.push_back({i, offset, static_cast<uint32_t>(last.sequences.size() - offset)});
+			previous = paint;
+		}
+		return last;
+	}
+
+	// ячейки строки глифа в битовую маску строки кадра начиная с ячейки cell (в маске нужен байт запаса)
+	static void appendMask(vector<uint8_t>& row, size_t cell, const uint8_t* mask, int width) {
+		const unsigned shift = cell % 8;
+		uint8_t* out = row.data() + cell / 8;
+		for (int c = 0; c < width; c += 8, mask++, out++) {
+			uint8_t bits = *mask;
+			if (width - c < 8) bits &= static_cast<uint8_t>(0xFF00 >> (width - c));
+			out[0] |= static_cast<uint8_t>(bits >> shift);
+			if (shift != 0) out[1] |= static_cast<uint8_t>(bits << (8 - shift));
+		}
+	}
+
+	// кадр с градиентом по маскам глифов, как и одноцветный: по строкам - одна последовательность цвета на строку;
+	// по столбцам строка собирается в общую маску и раскрывается по сериям, цвет пишется перед первой закрашенной ячейкой серии
+	static string renderFrame(const string& text, const Gradient& gradient, const string& symbol = "*", const string& fontId = "1") {
+		FontLoader::ReadGuard guard(fontId);
+		const Font& font = guard.font();
+		if (font.empty()) {
+			reportEmptyFont(fontId);
+			return {};
+		}
+		const SymbolExpander& expander = SymbolExpander::forSymbol(symbol);
+		vector<const Font::Glyph*> glyphs;
+		glyphs.reserve(text.size());
+		size_t rowCells = 0;
+		forEachCodePoint(text, [&](char32_t cp) {
+			glyphs.push_back(&font.glyph(cp));
+			rowCells += glyphs.back()->width + 1;
+		});
+		const bool byColumns = gradient.direction == Gradient::Direction::COLUMNS;
+		const GradientRuns& runs = gradientRuns(gradient, byColumns ? static_cast<int>(rowCells) : font.height());
+
+		string frame;
+		const size_t rowBytes = rowCells * expander.symbolSize() + expander.slack();
+		frame.reserve(font.height() * (rowBytes + 16) + runs.sequences.size() * (byColumns ? font.height() : 1));
+		vector<uint8_t> rowMask(byColumns ? rowCells / 8 + 2 : 0);
+		for (int i = 0; i < font.height(); i++) {
+			if (!byColumns) {
+				const auto& run = *(upper_bound(runs.runs.begin(), runs.runs.end(), i, [](int row, const GradientRuns::Run& r) { return row < r.start; }) - 1);
+				frame.append(runs.sequences, run.sequence, run.length);
+				const size_t begin = frame.size();
+				frame.resize(begin + rowBytes);
+				char* out = &frame[begin];
+				for (const Font::Glyph* glyph : glyphs) {
+					out = expander.expand(out, font.mask(*glyph, i), glyph->width);
+					*out++ = ' ';
+				}
+				frame.resize(static_cast<size_t>(out - frame.data()));
+			} else {
+				fill(rowMask.begin(), rowMask.end(), 0);
+				size_t cell = 0;
+				for (const Font::Glyph* glyph : glyphs) {
+					appendMask(rowMask, cell, font.mask(*glyph, i), glyph->width);
+					cell += glyph->width + 1;
+				}
+				const size_t begin = frame.size();
+				frame.resize(begin + runs.sequences.size() + rowBytes);
+				char* out = &frame[begin];
+				for (size_t r = 0; r < runs.runs.size(); r++) {
+					const size_t start = static_cast<size_t>(runs.runs[r].start);
+					const size_t end = r + 1 < runs.runs.size() ? static_cast<size_t>(runs.runs[r + 1].start) : rowCells;
+					size_t first = start;
+					while (first < end && !(rowMask[first / 8] & (0x80 >> first % 8))) first++;
+					memset(out, ' ', first - start);
+					out += first - start;
+					if (first == end) continue; // в серии из пробелов цвет не нужен
+					memcpy(out, runs.sequences.data() + runs.runs[r].sequence, runs.runs[r].length);
+					out += runs.runs[r].length;
+					out = expander.expand(out, rowMask.data(), first, static_cast<int>(end - first));
+				}
+				frame.resize(static_cast<size_t>(out - frame.data()));
+			}
+			frame += ANSICodes::resetColor();
+			frame += '\n';
+		}
+		return frame;
+	}
+
+	static void printStatic(const string& text,
+							const Gradient& gradient,
+							const pair<int, int>& position,
+							const string& symbol = "*",
+							const string& fontId = "1") {
+		string frame = renderFrame(text, gradient, symbol, fontId);
+		if (frame.empty()) return;
+		writePlaced(cout, frame, position);
+	}
+
+	// включить кэш кадров printStatic с бюджетом памяти в байтах (можно вызывать во время вывода из других потоков)
+	static void enableRenderCache(size_t budgetBytes) {
+		lock_guard<mutex> lock(cacheMutex);
+		if (cache) {
+			cache->setBudget(budgetBytes);
+		} else {
+			cache = make_shared<RenderCache>(budgetBytes);
+		}
+	}
+
+	// потоки, уже взявшие кэш, дорабатывают с ним; память освобождает последний из них
+	static void disableRenderCache() {
+		lock_guard<mutex> lock(cacheMutex);
+		cache.reset();
+	}
+
+	// баннер в файловом формате вместо терминала (symbol используется только в HTML)
+	static string exportBanner(const string& text, ExportFormat format, Paint color, const string& symbol = "*",
+							   const string& fontId = "1", int scale = 4) {
+		vector<string> rows = composeRows(text, fontId);
+		switch (format) {
+		case ExportFormat::PPM: return BannerExporter::toPPM(rows, color, Color::BLACK, scale);
+		case ExportFormat::PNG: return BannerExporter::toPNG(rows, color, Color::BLACK, scale);
+		default: return BannerExporter::toHTML(rows, color, symbol);
+		}
+	}
+
+	static RenderCache::Stats renderCacheStats() {
+		const shared_ptr<RenderCache> active = activeCache();
+		return active ? active->snapshot() : RenderCache::Stats{};
+	}
+
+	// Экземпляр с фиксированным стилем
+	Printer(Paint color, const pair<int, int>& position, const string& symbol = "*", const string& fontId = "1")
+		: color(color), position(position), fontId(fontId), symbol(symbol) {
+		FontLoader::loadFont(fontId);
+	}
+
+	Printer(const Gradient& gradient, const pair<int, int>& position, const string& symbol = "*", const string& fontId = "1")
+		: Printer(gradient.from, position, symbol, fontId) {
+		this->gradient = gradient;
+	}
+
+	// баннер в задний буфер target в позиции принтера, без вывода; возвращает высоту (0 - нечего рисовать)
+	int draw(ScreenBuffer& target, const string& text) const {
+		vector<string> rows = composeRows(text, fontId);
+		if (rows.empty()) return 0;
+
+		uint8_t symbolId = target.internSymbol(symbol.empty() ? "*" : symbol);
+		int top = max(0, position.first - 1), left = max(0, position.second - 1);
+		target.resize(top + static_cast<int>(rows.size()), left + static_cast<int>(rows[0].size())); // сразу весь прямоугольник, а не по ячейке
+		for (int r = 0; r < static_cast<int>(rows.size()); r++) {
+			for (int c = 0; c < static_cast<int>(rows[r].size()); c++) {
+				if (rows[r][c] != ' ') target.put(top + r, left + c, rows[r][c], symbolId, color);
+			}
+		}
+		if (gradient) target.applyGradient(top, left, static_cast<int>(rows.size()), static_cast<int>(rows[0].size()), *gradient);
+		return static_cast<int>(rows.size());
+	}
+
+	// рисуем в буфер и выводим только отличия от предыдущего кадра (без clearScreen на каждый вызов)
+	void print(const string& text) {
+		screen.clear();
+		const int height = draw(screen, text);
+		if (height == 0) return;
+		int top = max(0, position.first - 1);
+		cout << screen.present() << ANSICodes::moveCursor(top + height + 1, 1) << flush;
+	}
+
+	// готовая раскладка рисуется в позиции принтера его цветом и символом, без повторного расчета
+	void print(const TextLayout& layout) {
+		uint8_t symbolId = screen.internSymbol(symbol.empty() ? "*" : symbol);
+		int top = max(0, position.first - 1), left = max(0, position.second - 1);
+		screen.clear();
+		layout.draw(screen, top, left, symbolId, color);
+		if (gradient) screen.applyGradient(top, left, layout.height(), layout.width(), *gradient);
+		cout << screen.present() << ANSICodes::moveCursor(top + layout.height() + 1, 1) << flush;
+	}
+
+	const ScreenBuffer::FrameStats& lastFrameStats() const { return screen.lastStats(); }
+	const pair<int, int>& getPosition() const { return position; }
+
+	~Printer() {
+		// Восстановление состояния консоли
+		cout << ANSICodes::resetColor();
+	}
+};
+
+shared_ptr<RenderCache> Printer::cache;
+mutex Printer::cacheMutex;
+
+
+
+// много потоков одновременно грузят и рисуют шрифты, каждый результат сверяется с однопоточной отрисовкой
+int stressFonts(int threadCount, int iterations) {
+	const vector<string> fontIds = {"1", "2"};
+	const vector<string> texts = {"HELLO", "stress test", "The Quick Brown Fox", "xyz 123", "lAzY dOg"};
+	const size_t keys = fontIds.size() * texts.size();
+	auto hashRows = [](const vector<string>& rows) {
+		size_t h = rows.size();
+		for (const string& row : rows) h = h * 31 + std::hash<string>{}(row);
+		return h;
+	};
+
+	vector<vector<size_t>> seen(threadCount, vector<size_t>(keys, 0)); // у каждого потока свой массив, без гонок
+	atomic<long> renders{0}, emptyRenders{0}, unstable{0}; // пустой результат; тот же текст отрисовался по-разному
+	auto start = chrono::steady_clock::now();
+	vector<thread> workers;
+	for (int t = 0; t < threadCount; t++) {
+		workers.emplace_back([&, t] {
+			mt19937 rng(static_cast<unsigned>(t));
+			for (int i = 0; i < iterations; i++) {
+				size_t key = rng() % keys;
+				vector<string> rows = Printer::composeRows(texts[key % texts.size()], fontIds[key / texts.size()]);
+				if (rows.empty()) emptyRenders.fetch_add(1, memory_order_relaxed);
+				size_t h = hashRows(rows);
+				if (seen[t][key] == 0) {
+					seen[t][key] = h;
+				} else if (seen[t][key] != h) {
+					unstable.fetch_add(1, memory_order_relaxed);
+				}
+				renders.fetch_add(1, memory_order_relaxed);
+			}
+		});
+	}
+	for (thread& worker : workers) worker.join();
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+	long mismatches = unstable.load(); // плюс расхождения с однопоточной отрисовкой ниже
+	for (size_t key = 0; key < keys; key++) {
+		size_t reference = hashRows(Printer::composeRows(texts[key % texts.size()], fontIds[key / texts.size()]));
+		for (int t = 0; t < threadCount; t++) {
+			if (seen[t][key] != 0 && seen[t][key] != reference) mismatches++;
+		}
+	}
+	cout << threadCount << " threads, " << renders.load() << " renders in " << seconds << " s, "
+		 << FontLoader::loadCount() << " font loads, " << emptyRenders.load() << " empty renders, " << mismatches << " mismatches\n";
+	return (mismatches == 0 && emptyRenders.load() == 0 && FontLoader::loadCount() == static_cast<int>(fontIds.size())) ? 0 : 1;
+}
+
+// потоки без остановки рисуют баннер, пока другой поток переписывает файл шрифта, а FontWatcher его перезагружает.
+// Каждый кадр обязан совпасть со старым или с новым вариантом шрифта целиком
+int stressReload(int threadCount, int seconds) {
+	const FontTemplates original = FontLoader::readTemplates("1");
+	FontTemplates filled = original; // второй вариант: все ячейки глифов закрашены
+	for (auto& glyph : filled) {
+		for (string& row : glyph.second) replace(row.begin(), row.end(), ' ', '#');
+	}
+	const filesystem::path dir = filesystem::temp_directory_path() / ("banner_reload_" + to_string(chrono::steady_clock::now().time_since_epoch().count()));
+	filesystem::create_directories(dir);
+	auto writeFont = [&](const FontTemplates& font, const string& fontId) {
+		const filesystem::path temp = dir / ("tmp_" + fontId);
+		{
+			ofstream out(temp);
+			for (const auto& glyph : font) {
+				const char32_t cp = glyph.first; // ключ пишется UTF-8, как в шрифтах
+				if (cp < 0x80) {
+					out << static_cast<char>(cp);
+				} else if (cp < 0x800) {
+					out << static_cast<char>(0xC0 | cp >> 6) << static_cast<char>(0x80 | (cp & 0x3F));
+				} else {
+					out << static_cast<char>(0xE0 | cp >> 12) << static_cast<char>(0x80 | (cp >> 6 & 0x3F)) << static_cast<char>(0x80 | (cp & 0x3F));
+				}
+				out << '\n';
+				for (const string& row : glyph.second) out << row << '\n';
+				out << '\n';
+			}
+		}
+		filesystem::rename(temp, dir / ("text" + fontId + ".txt")); // как редактор: новый файл подменяет старый целиком
+	};
+	writeFont(original, "1");
+	writeFont(filled, "9");
+
+	const string text = "HELLO RELOAD";
+	int mismatches = 0;
+	long renders = 0;
+	{
+		FontWatcher watcher(dir.string());
+		const string before = Printer::renderFrame(text, Color::GREEN, "#", "1");
+		const string after = Printer::renderFrame(text, Color::GREEN, "#", "9");
+
+		atomic<bool> stop{false};
+		atomic<long> total{0}, bad{0};
+		vector<thread> workers;
+		for (int t = 0; t < threadCount; t++) {
+			workers.emplace_back([&] {
+				while (!stop.load(memory_order_relaxed)) {
+					const string frame = Printer::renderFrame(text, Color::GREEN, "#", "1");
+					if (frame != before && frame != after) bad.fetch_add(1, memory_order_relaxed);
+					total.fetch_add(1, memory_order_relaxed);
+				}
+			});
+		}
+		auto deadline = chrono::steady_clock::now() + chrono::seconds(max(1, seconds));
+		for (int i = 0; chrono::steady_clock::now() < deadline; i++) {
+			writeFont(i % 2 ? original : filled, "1");
+			this_thread::sleep_for(chrono::milliseconds(100));
+		}
+		this_thread::sleep_for(chrono::milliseconds(300)); // последняя запись тоже должна перечитаться
+		stop.store(true);
+		for (thread& worker : workers) worker.join();
+		renders = total.load();
+		mismatches = static_cast<int>(bad.load());
+	}
+	FontLoader::reclaim();
+	filesystem::remove_all(dir);
+	cout << threadCount << " threads, " << renders << " renders, " << FontLoader::reloadCount() << " reloads, "
+		 << mismatches << " mismatches\n";
+	return (mismatches == 0 && FontLoader::reloadCount() > 0) ? 0 : 1;
+}
+
+struct LayerClip { // 1-based, как позиция принтера; height/width <= 0 - без ограничения
+	int row = 1;
+	int col = 1;
+	int height = 0;
+	int width = 0;
+};
+
+// один экран на несколько Printer: каждый принтер - слой со своим текстом, z-порядком и прямоугольником отсечения.
+// Измененные слои растеризуются параллельно в свои буферы, потом сливаются по z в общий экран,
+// и весь кадр уходит в терминал одной записью (только отличия от прошлого кадра)
+class Compositor {
+private:
+	struct Layer {
+		const Printer* printer; // принтер не принадлежит компоновщику и должен жить дольше него
+		string text;
+		int z;
+		LayerClip clip;
+		bool opaque = false;    // непрозрачный слой стирает нижние в своем прямоугольнике
+		bool visible = true;
+		bool dirty = true;      // текст изменился - растр нужно перерисовать
+		int height = 0;
+		ScreenBuffer raster;    // растр слоя в координатах экрана
+	};
+
+	vector<unique_ptr<Layer>> layers;
+	ScreenBuffer surface;
+	unsigned threadCount;
+
+	// постоянные помощники: ждут кадр на condition_variable, главный поток растеризует вместе с ними
+	vector<thread> workers;
+	mutex poolMutex;
+	condition_variable poolWakeup;  // новый кадр или остановка
+	condition_variable poolDone;    // все помощники закончили кадр
+	vector<Layer*> jobs;            // измененные слои текущего кадра
+	atomic<size_t> nextJob{0};
+	uint64_t generation = 0;        // номер кадра с работой (под poolMutex)
+	unsigned busy = 0;              // сколько помощников еще не закончили кадр (под poolMutex)
+	bool stopping = false;
+
+	void rasterize(Layer& layer) {
+		layer.raster = ScreenBuffer();
+		layer.height = layer.printer->draw(layer.raster, layer.text);
+		layer.dirty = false;
+	}
+
+	void takeJobs() {
+		for (size_t i = nextJob.fetch_add(1); i < jobs.size(); i = nextJob.fetch_add(1)) rasterize(*jobs[i]);
+	}
+
+	void workerLoop(uint64_t seen) { // seen - кадр, который уже был при создании: его помощник не трогает
+		unique_lock<mutex> lock(poolMutex);
+		while (true) {
+			poolWakeup.wait(lock, [&] { return stopping || generation != seen; });
+			if (stopping) return;
+			seen = generation;
+			lock.unlock();
+			takeJobs();
+			lock.lock();
+			if (--busy == 0) poolDone.notify_one();
+		}
+	}
+
+	void rasterizeDirty() {
+		vector<Layer*> dirty;
+		for (auto& layer : layers) {
+			if (layer->dirty && layer->visible) dirty.push_back(layer.get());
+		}
+		const unsigned helpers = min<unsigned>(threadCount, static_cast<unsigned>(dirty.size())) - (dirty.empty() ? 0 : 1);
+		if (helpers == 0) { // один слой - без потоков
+			for (Layer* layer : dirty) rasterize(*layer);
+			return;
+		}
+		if (workers.size() < helpers) { // потоки создаются, только когда их не хватает
+			uint64_t current;
+			{
+				lock_guard<mutex> lock(poolMutex);
+				current = generation;
+			}
+			while (workers.size() < helpers) workers.emplace_back([this, current] { workerLoop(current); });
+		}
+
+		{
+			lock_guard<mutex> lock(poolMutex);
+			jobs = move(dirty);
+			nextJob.store(0);
+			busy = static_cast<unsigned>(workers.size());
+			generation++;
+		}
+		poolWakeup.notify_all();
+		takeJobs();
+		unique_lock<mutex> lock(poolMutex);
+		poolDone.wait(lock, [&] { return busy == 0; });
+	}
+
+	void merge(const Layer& layer) {
+		const int clipTop = max(0, layer.clip.row - 1), clipLeft = max(0, layer.clip.col - 1);
+		const int clipBottom = layer.clip.height > 0 ? clipTop + layer.clip.height : numeric_limits<int>::max();
+		const int clipRight = layer.clip.width > 0 ? clipLeft + layer.clip.width : numeric_limits<int>::max();
+		const int bottom = min(layer.raster.height(), clipBottom), right = min(layer.raster.width(), clipRight);
+		const pair<int, int>& position = layer.printer->getPosition();
+		const int top = max(clipTop, position.first - 1), left = max(clipLeft, position.second - 1);
+
+		array<uint8_t, 256> symbols{}; // палитра слоя -> палитра экрана
+		for (int r = top; r < bottom; r++) {
+			for (int c = left; c < right; c++) {
+				const Cell& cell = layer.raster.cell(r, c);
+				if (cell.ch == ' ') {
+					if (layer.opaque) surface.put(r, c, ' ', 0, Color::RESET);
+					continue;
+				}
+				if (cell.symbol != 0 && symbols[cell.symbol] == 0) symbols[cell.symbol] = surface.internSymbol(layer.raster.symbolText(cell.symbol));
+				surface.put(r, c, cell.ch, cell.symbol ? symbols[cell.symbol] : 0, cell.color);
+			}
+		}
+	}
+
+public:
+	explicit Compositor(unsigned threads = thread::hardware_concurrency()) : threadCount(max(1u, threads)) {}
+
+	~Compositor() {
+		{
+			lock_guard<mutex> lock(poolMutex);
+			stopping = true;
+		}
+		poolWakeup.notify_all();
+		for (thread& worker : workers) worker.join();
+	}
+
+	// возвращает номер слоя для setText/setZ/setClip
+	size_t addLayer(const Printer& printer, const string& text = "", int z = 0, const LayerClip& clip = {}) {
+		layers.push_back(make_unique<Layer>());
+		Layer& layer = *layers.back();
+		layer.printer = &printer;
+		layer.text = text;
+		layer.z = z;
+		layer.clip = clip;
+		return layers.size() - 1;
+	}
+
+	void setText(size_t layer, const string& text) {
+		if (layers[layer]->text == text) return;
+		layers[layer]->text = text;
+		layers[layer]->dirty = true;
+	}
+	void setZ(size_t layer, int z) { layers[layer]->z = z; }
+	void setClip(size_t layer, const LayerClip& clip) { layers[layer]->clip = clip; }
+	void setOpaque(size_t layer, bool opaque) { layers[layer]->opaque = opaque; }
+	void setVisible(size_t layer, bool visible) { layers[layer]->visible = visible; }
+	void invalidate(size_t layer) { layers[layer]->dirty = true; } // например, после перезагрузки шрифта
+
+	// кадр целиком: изменения экрана и курсор под нижним слоем
+	string composeFrame() {
+		rasterizeDirty();
+		vector<const Layer*> order;
+		for (const auto& layer : layers) {
+			if (layer->visible) order.push_back(layer.get());
+		}
+		stable_sort(order.begin(), order.end(), [](const Layer* a, const Layer* b) { return a->z < b->z; });
+
+		surface.clear();
+		int bottom = 0;
+		for (const Layer* layer : order) {
+			merge(*layer);
+			if (layer->height > 0) bottom = max(bottom, layer->printer->getPosition().first - 1 + layer->height);
+		}
+		string frame = surface.present();
+		frame += ANSICodes::moveCursor(bottom + 1, 1);
+		return frame;
+	}
+
+	void present(ostream& out = cout) {
+		const string frame = composeFrame();
+		out.write(frame.data(), static_cast<streamsize>(frame.size()));
+		out.flush();
+	}
+
+	const ScreenBuffer::FrameStats& lastFrameStats() const { return surface.lastStats(); }
+};
+
+// панель из 6 виджетов: каждый Printer::printStatic (clearScreen на каждый виджет) против одного кадра Compositor
+int benchDashboard(int frames, unsigned threads) {
+	vector<unique_ptr<Printer>> widgets;
+	const Paint colors[] = {Color::RED, Color::GREEN, Color::YELLOW, Color::BLUE, Color::MAGENTA, Color::CYAN};
+	for (int i = 0; i < 6; i++) {
+		widgets.push_back(make_unique<Printer>(colors[i], pair<int, int>{1 + (i / 2) * 7, 1 + (i % 2) * 44}, "#", "1"));
+	}
+	Compositor compositor(threads);
+	vector<size_t> ids;
+	for (int i = 0; i < 6; i++) ids.push_back(compositor.addLayer(*widgets[i], "", i, {1 + (i / 2) * 7, 1 + (i % 2) * 44, 6, 42}));
+	auto textOf = [](int widget, int frame) { // в шрифтах нет цифр - счетчик буквами
+		string text = "W";
+		text += static_cast<char>('A' + widget);
+		text += ' ';
+		for (int n = frame * (widget + 1), k = 0; k < 3; k++, n /= 26) text += static_cast<char>('A' + n % 26);
+		return text;
+	};
+
+	size_t separateBytes = 0;
+	ostringstream sink;
+	auto start = chrono::steady_clock::now();
+	for (int f = 0; f < frames; f++) {
+		for (int i = 0; i < 6; i++) { // то же, что пишет printStatic: очистка, отступы, кадр
+			const string frame = Printer::renderFrame(textOf(i, f), colors[i], "#", "1");
+			sink.str("");
+			Printer::writePlaced(sink, frame, {1 + (i / 2) * 7, 1 + (i % 2) * 44});
+			separateBytes += static_cast<size_t>(sink.tellp());
+		}
+	}
+	double separateUs = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count() / max(1, frames);
+
+	size_t compositedBytes = 0;
+	start = chrono::steady_clock::now();
+	for (int f = 0; f < frames; f++) {
+		for (int i = 0; i < 6; i++) compositor.setText(ids[i], textOf(i, f));
+		sink.str("");
+		compositor.present(sink);
+		compositedBytes += sink.str().size();
+	}
+	double compositedUs = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count() / max(1, frames);
+
+	cout << "printStatic x6: " << separateUs << " us/frame, " << separateBytes / max(1, frames) << " bytes/frame, "
+		 << "6 clears/frame, only the last widget stays on screen\n";
+	cout << "compositor:     " << compositedUs << " us/frame, " << compositedBytes / max(1, frames) << " bytes/frame, 1 write/frame, "
+		 << threads << " threads\n";
+	return 0;
+}
+
+// кадр с двумя слоями, потом с layerCount слоями: новые помощники появляются, когда номер кадра уже не 0.
+// Каждый кадр сравнивается с компоновщиком без потоков
+int stressCompositor(int rounds, unsigned threads) {
+	const int layerCount = static_cast<int>(max(4u, threads * 2));
+	const Paint colors[] = {Color::RED, Color::GREEN, Color::YELLOW, Color::BLUE, Color::MAGENTA, Color::CYAN};
+	vector<unique_ptr<Printer>> widgets;
+	for (int i = 0; i < layerCount; i++) {
+		widgets.push_back(make_unique<Printer>(colors[i % 6], pair<int, int>{1 + (i / 2) * 7, 1 + (i % 2) * 44}, "#", "1"));
+	}
+	auto textOf = [](int widget, int frame) {
+		string text = "W";
+		text += static_cast<char>('A' + widget % 26);
+		text += ' ';
+		for (int n = frame * (widget + 1), k = 0; k < 3; k++, n /= 26) text += static_cast<char>('A' + n % 26);
+		return text;
+	};
+
+	int mismatches = 0;
+	for (int round = 0; round < rounds; round++) {
+		Compositor parallel(threads), serial(1);
+		int added = 0;
+		for (int frame = 0; frame < 4; frame++) {
+			for (const int wanted = frame == 0 ? 2 : layerCount; added < wanted; added++) {
+				const LayerClip clip{1 + (added / 2) * 7, 1 + (added % 2) * 44, 6, 42};
+				parallel.addLayer(*widgets[added], "", added, clip);
+				serial.addLayer(*widgets[added], "", added, clip);
+			}
+			for (int i = 0; i < added; i++) {
+				parallel.setText(i, textOf(i, round + frame));
+				serial.setText(i, textOf(i, round + frame));
+			}
+			if (parallel.composeFrame() != serial.composeFrame()) mismatches++;
+		}
+	}
+	cout << rounds << " rounds, " << layerCount << " layers, " << threads << " threads, " << mismatches << " mismatches\n";
+	return mismatches == 0 ? 0 : 1;
+}
+
+// ширина терминала в колонках: TIOCGWINSZ (консоль на Windows), потом переменная COLUMNS, иначе 80
+int terminalWidth() {
+#ifdef _WIN32
+	CONSOLE_SCREEN_BUFFER_INFO info;
+	if (GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE), &info)) {
+		return info.srWindow.Right - info.srWindow.Left + 1;
+	}
+#else
+	struct winsize ws;
+	if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_col > 0) {
+		return ws.ws_col;
+	}
+#endif
+	const char* columns = getenv("COLUMNS");
+	if (columns != nullptr && atoi(columns) > 0) {
+		return atoi(columns);
+	}
+	return 80;
+}
+
+// потоковый вывод большим шрифтом: текст подается кусками, глифы раскладываются в строки по ширине терминала,
+// каждая готовая строка баннера сразу выводится. Память - одна строка баннера, независимо от длины входа
+class StreamPrinter {
+private:
+	string fontId;
+	FontLoader::ReadGuard guard; // снимок шрифта держится одну строку баннера, потом берется свежий
+	const Font* font;
+	Paint color;
+	int width;
+	ostream& out;
+	const SymbolExpander expander;
+	vector<const Font::Glyph*> line; // глифы текущей строки баннера
+	int usedColumns = 0;
+	string frame;            // буфер вывода одной строки баннера, переиспользуется
+	string carry;            // начало символа UTF-8, разрезанного границей кусков
+	size_t bannerLines = 0;
+
+	void flushLine() {
+		frame.clear();
+		const size_t rowBytes = static_cast<size_t>(usedColumns) * expander.symbolSize() + expander.slack();
+		for (int r = 0; r < font->height(); r++) {
+			ANSICodes::appendColor(frame, color);
+			const size_t begin = frame.size();
+			frame.resize(begin + rowBytes);
+			char* next = &frame[begin];
+			for (const Font::Glyph* glyph : line) {
+				next = expander.expand(next, font->mask(*glyph, r), glyph->width);
+				*next++ = ' ';
+			}
+			frame.resize(static_cast<size_t>(next - frame.data()));
+			frame += ANSICodes::resetColor();
+			frame += '\n';
+		}
+		out.write(frame.data(), static_cast<streamsize>(frame.size()));
+		out.flush();
+		line.clear();
+		usedColumns = 0;
+		bannerLines++;
+		pinFont();
+	}
+
+	void pinFont() { // строка пуста, указателей на глифы нет - можно перейти на перезагруженный шрифт
+		guard = FontLoader::ReadGuard(fontId);
+		font = &guard.font();
+	}
+
+public:
+	StreamPrinter(Paint color, const string& symbol = "*", const string& fontId = "1", int width = terminalWidth(), ostream& out = cout)
+		: fontId(fontId), guard(fontId), font(&guard.font()), color(color), width(max(1, width)), out(out), expander(symbol) {
+		line.reserve(static_cast<size_t>(this->width));
+	}
+
+	void put(char32_t c) {
+		if (c == '\r') return;
+		if (c == '\n') {
+			flushLine();
+			return;
+		}
+		if (c == '\t' || c == ' ') {
+			if (usedColumns == 0) return; // пробелы в начале перенесенной строки не рисуем
+		}
+		const Font::Glyph& glyph = font->glyph(c == '\t' ? ' ' : c);
+		if (usedColumns > 0 && usedColumns + glyph.width + 1 > width) { // +1 - пробел после глифа, иначе терминал сам перенесет строку
+			flushLine();
+			if (c == ' ' || c == '\t') return;
+		}
+		line.push_back(&glyph);
+		usedColumns += glyph.width + 1;
+	}
+
+	void feed(const char* data, size_t size) {
+		size_t start = 0;
+		if (!carry.empty()) { // дописываем символ, начатый в прошлом куске
+			const size_t length = utf8SequenceLength(static_cast<unsigned char>(carry[0]));
+			start = min(size, length - carry.size());
+			carry.append(data, start);
+			if (carry.size() < length) return;
+			forEachCodePoint(carry, [this](char32_t c) { put(c); });
+			carry.clear();
+		}
+		size_t end = size; // незаконченный символ в конце куска откладываем до следующего
+		for (size_t back = 1; back <= 3 && back <= size - start; back++) {
+			const unsigned char b = static_cast<unsigned char>(data[size - back]);
+			if ((b & 0xC0) == 0x80) continue;
+			if (utf8SequenceLength(b) > back) end = size - back;
+			break;
+		}
+		carry.assign(data + end, size - end);
+		forEachCodePoint(data + start, end - start, [this](char32_t c) { put(c); });
+	}
+
+	void finish() {
+		forEachCodePoint(carry, [this](char32_t c) { put(c); }); // оборванный символ - U+FFFD
+		carry.clear();
+		if (usedColumns > 0) flushLine();
+	}
+
+	size_t linesPrinted() const { return bannerLines; }
+};
+
+// гистограмма длительностей в микросекундах: до 64 мкс точно, дальше 64 корзины на каждую степень двойки (ошибка до 1.6%).
+// Запись и чтение без блокировок, можно читать из другого потока во время анимации
+class FrameHistogram {
+private:
+	array<atomic<uint64_t>, 64 * 64> counts{};
+	atomic<uint64_t> total{0};
+	atomic<uint64_t> maximum{0};
+
+	static size_t bucketOf(uint64_t us) {
+		if (us < 64) return static_cast<size_t>(us);
+		int log = 6; // номер старшего бита
+		for (uint64_t rest = us >> 7; rest != 0; rest >>= 1) log++;
+		return static_cast<size_t>(log - 5) * 64 + ((us >> (log - 6)) & 63);
+	}
+	static uint64_t bucketLow(size_t bucket) {
+		if (bucket < 64) return bucket;
+		return static_cast<uint64_t>(64 + bucket % 64) << (bucket / 64 - 1);
+	}
+
+public:
+	void record(uint64_t us) {
+		counts[bucketOf(us)].fetch_add(1, memory_order_relaxed);
+		total.fetch_add(1, memory_order_relaxed);
+		uint64_t seen = maximum.load(memory_order_relaxed);
+		while (us > seen && !maximum.compare_exchange_weak(seen, us, memory_order_relaxed)) {}
+	}
+
+	uint64_t count() const { return total.load(memory_order_relaxed); }
+	uint64_t max() const { return maximum.load(memory_order_relaxed); }
+
+	uint64_t percentile(double q) const { // нижняя граница корзины, в которую попал q-квантиль
+		const uint64_t n = count();
+		if (n == 0) return 0;
+		const uint64_t rank = static_cast<uint64_t>(q * static_cast<double>(n - 1)) + 1;
+		uint64_t seen = 0;
+		for (size_t b = 0; b < counts.size(); b++) {
+			seen += counts[b].load(memory_order_relaxed);
+			if (seen >= rank) return bucketLow(b);
+		}
+		return max();
+	}
+};
+
+struct AnimationOptions {
+	int fps = 30;
+	int width = 0;              // окно бегущей строки в ячейках, 0 - до правого края терминала
+	int gap = 8;                // пустых ячеек между повторами бегущей строки
+	int cellsPerSecond = 30;    // скорость бегущей строки
+	int glyphsPerSecond = 10;   // скорость печатной машинки
+	int blinkMs = 500;          // полупериод мигания
+};
+
+// анимация баннера: кадр готовится в ScreenBuffer заранее, а выводится одной записью по тику таймера
+// с фиксированным периодом (timerfd на Linux, sleep_until в остальных системах)
+class Animator {
+public:
+	enum class Effect { MARQUEE, BLINK, TYPEWRITER };
+
+	struct Stats {
+		uint64_t frames = 0;
+		uint64_t dropped = 0;   // пропущенные тики: кадр не успел к своему времени
+		uint64_t intervalP50 = 0, intervalP99 = 0, intervalMax = 0; // мкс между соседними выводами кадров
+		uint64_t renderP50 = 0, renderP99 = 0, renderMax = 0;       // мкс на подготовку кадра
+	};
+
+private:
+	Effect effect;
+	TextLayout layout;
+	vector<string> cells;       // баннер целиком, как TextLayout::rows
+	vector<vector<int>> order;  // для печатной машинки: номер глифа, которому принадлежит ячейка
+	Paint color;
+	string symbol;
+	pair<int, int> position;    // {row, col}, 1-based
+	AnimationOptions options;
+	ScreenBuffer screen;
+	uint8_t symbolId;
+	atomic<bool> stopping{false};
+	atomic<uint64_t> dropped{0};
+	FrameHistogram intervals;
+	FrameHistogram renders;
+
+	void compose(uint64_t tick) {
+		const int top = max(0, position.first - 1), left = max(0, position.second - 1);
+		screen.clear();
+		screen.resize(top + layout.height(), left + 1);
+		const uint64_t fps = static_cast<uint64_t>(options.fps);
+		if (effect == Effect::MARQUEE) {
+			const int viewport = options.width > 0 ? options.width : max(1, terminalWidth() - left);
+			const uint64_t period = max<uint64_t>(1, static_cast<uint64_t>(layout.width() + max(0, options.gap))); // пустой текст без зазора
+			const uint64_t offset = tick * static_cast<uint64_t>(max(1, options.cellsPerSecond)) / fps;
+			for (int r = 0; r < layout.height(); r++) {
+				for (int c = 0; c < viewport; c++) {
+					const uint64_t source = (offset + static_cast<uint64_t>(c)) % period;
+					if (source < cells[r].size() && cells[r][source] != ' ') screen.put(top + r, left + c, cells[r][source], symbolId, color);
+				}
+			}
+			return;
+		}
+		int shown = numeric_limits<int>::max(); // BLINK во включенной фазе рисует все
+		if (effect == Effect::BLINK) {
+			const uint64_t halfPeriod = max<uint64_t>(1, static_cast<uint64_t>(options.blinkMs) * fps / 1000);
+			if ((tick / halfPeriod) % 2 == 1) shown = 0;
+		} else {
+			shown = static_cast<int>(min<uint64_t>(tick * static_cast<uint64_t>(max(1, options.glyphsPerSecond)) / fps,
+												   numeric_limits<int>::max()));
+		}
+		for (int r = 0; r < layout.height(); r++) {
+			for (int c = 0; c < layout.width(); c++) {
+				if (cells[r][c] != ' ' && order[r][c] < shown) screen.put(top + r, left + c, cells[r][c], symbolId, color);
+			}
+		}
+	}
+
+public:
+	Animator(Effect effect, const string& text, Paint color, const pair<int, int>& position, const string& symbol = "*",
+			 const string& fontId = "1", const AnimationOptions& options = {})
+		: effect(effect), layout(text, fontId), cells(layout.rows()), color(color), symbol(symbol.empty() ? "*" : symbol),
+		  position(position), options(options) {
+		this->options.fps = max(1, options.fps);
+		symbolId = screen.internSymbol(this->symbol);
+		order.assign(layout.height(), vector<int>(layout.width(), numeric_limits<int>::max()));
+		const vector<TextLayout::PlacedGlyph>& glyphs = layout.glyphs();
+		for (size_t g = 0; g < glyphs.size(); g++) {
+			for (int r = 0; r < layout.glyphHeight(); r++) {
+				for (int c = 0; c < glyphs[g].glyph->width; c++) {
+					int& owner = order[glyphs[g].y + r][glyphs[g].x + c];
+					owner = min(owner, static_cast<int>(g)); // при кернинге ячейка достается первому глифу
+				}
+			}
+		}
+	}
+
+	// выводит frameCount кадров (0 - пока не вызван stop() из другого потока)
+	void run(uint64_t frameCount = 0, ostream& out = cout) {
+		const chrono::nanoseconds period(1000000000LL / options.fps);
+#ifdef __linux__
+		int timer = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+		itimerspec spec{};
+		spec.it_interval.tv_sec = static_cast<time_t>(period.count() / 1000000000);
+		spec.it_interval.tv_nsec = static_cast<long>(period.count() % 1000000000);
+		spec.it_value = spec.it_interval;
+		if (timer >= 0) timerfd_settime(timer, 0, &spec, nullptr);
+#endif
+		auto next = chrono::steady_clock::now();
+		auto waitTick = [&]() -> uint64_t { // сколько тиков прошло с прошлого ожидания (больше 1 - кадры пропущены)
+#ifdef __linux__
+			if (timer >= 0) {
+				uint64_t expirations = 0;
+				ssize_t got;
+				while ((got = read(timer, &expirations, sizeof expirations)) < 0 && errno == EINTR) {} // сигнал - ждем тот же тик дальше
+				if (got == sizeof expirations) return expirations;
+				close(timer); // таймер сломан: дальше по sleep_until, расписание - от текущего момента
+				timer = -1;
+				next = chrono::steady_clock::now();
+			}
+#endif
+			next += period;
+			this_thread::sleep_until(next);
+			const auto late = chrono::steady_clock::now() - next;
+			const uint64_t missed = late > period ? static_cast<uint64_t>(late / period) : 0;
+			next += period * missed;
+			return 1 + missed;
+		};
+
+		uint64_t tick = 1;
+		auto renderStart = chrono::steady_clock::now();
+		compose(tick); // следующий кадр готов заранее, по тику остается только вывести
+		string pending = screen.present();
+		renders.record(static_cast<uint64_t>(chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - renderStart).count()));
+		auto lastPresent = chrono::steady_clock::now();
+		for (uint64_t frame = 0; (frameCount == 0 || frame < frameCount) && !stopping.load(memory_order_relaxed); frame++) {
+			const uint64_t elapsed = waitTick();
+			if (elapsed > 1) { // опоздали: догоняем расписание, а не показываем устаревший кадр
+				tick += elapsed - 1;
+				dropped.fetch_add(elapsed - 1, memory_order_relaxed);
+				compose(tick);
+				pending += screen.present();
+			}
+			out.write(pending.data(), static_cast<streamsize>(pending.size()));
+			out.flush();
+			const auto presented = chrono::steady_clock::now();
+			if (frame > 0) intervals.record(static_cast<uint64_t>(chrono::duration_cast<chrono::microseconds>(presented - lastPresent).count()));
+			lastPresent = presented;
+
+			renderStart = chrono::steady_clock::now();
+			compose(++tick);
+			pending = screen.present();
+			renders.record(static_cast<uint64_t>(chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - renderStart).count()));
+		}
+#ifdef __linux__
+		if (timer >= 0) close(timer);
+#endif
+		out << ANSICodes::resetColor() << ANSICodes::moveCursor(max(1, position.first) + layout.height(), 1) << flush;
+	}
+
+	void stop() { stopping.store(true); }
+
+	Stats stats() const {
+		Stats result;
+		result.frames = intervals.count() + (intervals.count() > 0 ? 1 : 0);
+		result.dropped = dropped.load(memory_order_relaxed);
+		result.intervalP50 = intervals.percentile(0.5);
+		result.intervalP99 = intervals.percentile(0.99);
+		result.intervalMax = intervals.max();
+		result.renderP50 = renders.percentile(0.5);
+		result.renderP99 = renders.percentile(0.99);
+		result.renderMax = renders.max();
+		return result;
+	}
+};
+
+// main --animate marquee|blink|typewriter текст [fps] [секунд] [шрифт] [символ] [цвет]
+int animateBanner(const vector<string>& args) {
+	if (args.size() < 2) {
+		cerr << "usage: --animate marquee|blink|typewriter text [fps] [seconds] [font] [symbol] [color]\n";
+		return 1;
+	}
+	Animator::Effect effect = args[0] == "blink" ? Animator::Effect::BLINK
+							: args[0] == "typewriter" ? Animator::Effect::TYPEWRITER : Animator::Effect::MARQUEE;
+	AnimationOptions options;
+	options.fps = args.size() > 2 ? max(1, atoi(args[2].c_str())) : 30;
+	const int seconds = args.size() > 3 ? max(1, atoi(args[3].c_str())) : 5;
+	Animator animator(effect, args[1], args.size() > 6 ? stringToPaint(args[6]) : Paint(Color::GREEN), {2, 1},
+					  args.size() > 5 ? args[5] : "#", args.size() > 4 ? args[4] : "1", options);
+	animator.run(static_cast<uint64_t>(options.fps) * static_cast<uint64_t>(seconds));
+
+	const Animator::Stats stats = animator.stats();
+	cerr << stats.frames << " frames at " << options.fps << " fps, " << stats.dropped << " dropped; frame interval us p50 "
+		 << stats.intervalP50 << " p99 " << stats.intervalP99 << " max " << stats.intervalMax << "; render us p50 "
+		 << stats.renderP50 << " p99 " << stats.renderP99 << " max " << stats.renderMax << "\n";
+	return 0;
+}
+
+// пиковый размер резидентной памяти процесса в КБ (0 - неизвестно)
+long peakRssKb() {
+#ifdef _WIN32
+	return 0;
+#else
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+	return usage.ru_maxrss; // на Linux уже в КБ
+#endif
+}
+
+// повторная отрисовка готовой раскладки против полного пересчета раскладки на каждый кадр
+int benchLayout(int frames) {
+	const string paragraph = "The quick brown fox jumps over the lazy dog.\tTabs, AV and LT kerning pairs,\n"
+							 "and a second paragraph that is long enough to wrap several times at the layout width.\n";
+	string text;
+	for (int i = 0; i < 8; i++) text += paragraph;
+	LayoutOptions options;
+	options.maxWidth = 160;
+	options.align = Align::CENTER;
+
+	ScreenBuffer screen;
+	auto usPerFrame = [&](auto&& frame) {
+		frame(0);
+		auto start = chrono::steady_clock::now();
+		for (int f = 0; f < frames; f++) frame(f);
+		return chrono::duration<double, micro>(chrono::steady_clock::now() - start).count() / max(1, frames);
+	};
+
+	const TextLayout layout(text, "1", options);
+	double redraw = usPerFrame([&](int f) {
+		screen.clear();
+		layout.draw(screen, f % 3, f % 5, 1, f % 2 ? Color::GREEN : Color::RED);
+	});
+	double relayout = usPerFrame([&](int f) {
+		screen.clear();
+		TextLayout(text, "1", options).draw(screen, f % 3, f % 5, 1, f % 2 ? Color::GREEN : Color::RED);
+	});
+	cout << text.size() << " chars, " << layout.glyphs().size() << " glyphs, " << layout.width() << "x" << layout.height()
+		 << " cells: re-render " << redraw << " us/frame, relayout + render " << relayout << " us/frame\n";
+	return 0;
+}
+
+// streambuf без вывода: только считает байты (вместо терминала в --bench)
+class CountingSink : public streambuf {
+private:
+	size_t total = 0;
+
+protected:
+	int_type overflow(int_type ch) override {
+		if (ch != traits_type::eof()) total++;
+		return traits_type::not_eof(ch);
+	}
+	streamsize xsputn(const char*, streamsize count) override {
+		total += static_cast<size_t>(count);
+		return count;
+	}
+
+public:
+	size_t bytes() const { return total; }
+};
+
+// набор бенчмарков отрисовки: printStatic (без кэша и с кэшем) и Printer::print в пустой вывод
+// по длинам текста, шрифтам, ширине символа в байтах и видам цвета; результат - таблица и JSON
+int benchSuite(const string& jsonPath) {
+	struct Result {
+		string mode, fontId, symbol, color;
+		size_t length;
+		size_t calls;
+		double glyphsPerSec, bytesPerCall, allocsPerCall, allocBytesPerCall;
+		double p50, p90, p99, max; // мкс на вызов
+	};
+	const string alphabet = "The quick brown fox jumps over the lazy dog ";
+	auto textOf = [&](size_t length, bool reversed) {
+		string text;
+		while (text.size() < length) text += alphabet;
+		text.resize(length);
+		if (reversed) reverse(text.begin(), text.end()); // print с тем же текстом почти ничего не выводит
+		return text;
+	};
+	const vector<pair<string, Paint>> colors = {{"basic", Color::RED}, {"256", Paint::indexed(202)}, {"rgb", Paint::rgb(255, 136, 0)}};
+
+	CountingSink sink;
+	streambuf* terminal = cout.rdbuf(&sink);
+	vector<Result> results;
+	for (const string mode : {"printStatic", "printStatic+cache", "print"}) {
+		for (const string fontId : {"1", "2"}) {
+			for (const string symbol : {"#", "¤", "█"}) {
+				for (const auto& [colorName, color] : colors) {
+					for (size_t length : {8, 64, 512}) {
+						const string texts[2] = {textOf(length, false), textOf(length, true)};
+						if (mode == "printStatic+cache") Printer::enableRenderCache(8 << 20); else Printer::disableRenderCache();
+						Printer printer(color, {1, 1}, symbol, fontId);
+						auto call = [&](size_t i) {
+							if (mode == "print") printer.print(texts[i & 1]);
+							else Printer::printStatic(texts[i & 1], color, {1, 1}, symbol, fontId);
+						};
+						call(0); // прогрев: шрифт, кэш, первый кадр print с очисткой экрана
+						call(1);
+
+						vector<double> latencies;
+						latencies.reserve(4096);
+						const size_t bytesBefore = sink.bytes();
+						size_t allocs = 0, allocBytes = 0;
+						auto start = chrono::steady_clock::now();
+						auto elapsed = [&] { return chrono::duration<double>(chrono::steady_clock::now() - start).count(); };
+						for (size_t i = 0; latencies.size() < 4096 && (latencies.size() < 20 || elapsed() < 0.02); i++) {
+							const size_t countBefore = alloc_stats::count.load(memory_order_relaxed);
+							const size_t sizeBefore = alloc_stats::bytes.load(memory_order_relaxed);
+							auto t0 = chrono::steady_clock::now();
+							call(i);
+							auto t1 = chrono::steady_clock::now();
+							allocs += alloc_stats::count.load(memory_order_relaxed) - countBefore;
+							allocBytes += alloc_stats::bytes.load(memory_order_relaxed) - sizeBefore;
+							latencies.push_back(chrono::duration<double, micro>(t1 - t0).count());
+						}
+						const double seconds = elapsed();
+						const double calls = static_cast<double>(latencies.size());
+						sort(latencies.begin(), latencies.end());
+						auto percentile = [&](double q) { return latencies[static_cast<size_t>(q * (latencies.size() - 1))]; };
+						results.push_back({mode, fontId, symbol, colorName, length, latencies.size(),
+										   calls * static_cast<double>(length) / seconds,
+										   static_cast<double>(sink.bytes() - bytesBefore) / calls,
+										   static_cast<double>(allocs) / calls, static_cast<double>(allocBytes) / calls,
+										   percentile(0.5), percentile(0.9), percentile(0.99), latencies.back()});
+					}
+				}
+			}
+		}
+	}
+	Printer::disableRenderCache();
+	cout.rdbuf(terminal);
+
+	cout << "mode               font sym  color len   glyphs/s    bytes/call allocs/call  p50us   p99us\n";
+	for (const Result& r : results) {
+		char line[200];
+		snprintf(line, sizeof line, "%-18s %-4s ", r.mode.c_str(), r.fontId.c_str());
+		cout << line << r.symbol << "    "; // все символы набора занимают одну колонку, printf выравнивал бы по байтам
+		snprintf(line, sizeof line, "%-5s %-5zu %-11.0f %-10.0f ", r.color.c_str(), r.length, r.glyphsPerSec, r.bytesPerCall);
+		cout << line;
+		if (alloc_stats::enabled) snprintf(line, sizeof line, "%-11.1f ", r.allocsPerCall);
+		else snprintf(line, sizeof line, "%-11s ", "-");
+		cout << line;
+		snprintf(line, sizeof line, "%-7.1f %-7.1f\n", r.p50, r.p99);
+		cout << line;
+	}
+
+	if (!jsonPath.empty()) {
+		ofstream json(jsonPath);
+		if (!json.is_open()) {
+			cerr << "Не удалось открыть " << jsonPath << endl;
+			return 1;
+		}
+		auto escape = [](const string& text) { // в значениях только кавычки и обратная косая черта
+			string out;
+			for (char ch : text) {
+				if (ch == '"' || ch == '\\') out += '\\';
+				out += ch;
+			}
+			return out;
+		};
+#ifdef __VERSION__
+		const string compiler = __VERSION__;
+#else
+		const string compiler = "unknown";
+#endif
+		json.precision(10);
+		json << "{\n  \"suite\": \"2nd_lab renderer\",\n  \"timestamp\": "
+			 << chrono::duration_cast<chrono::seconds>(chrono::system_clock::now().time_since_epoch()).count()
+			 << ",\n  \"compiler\": \"" << escape(compiler) << "\",\n  \"threads\": " << thread::hardware_concurrency()
+			 << ",\n  \"results\": [\n";
+		for (size_t i = 0; i < results.size(); i++) {
+			const Result& r = results[i];
+			json << "    {\"mode\": \"" << r.mode << "\", \"font\": \"" << r.fontId << "\", \"symbol\": \"" << escape(r.symbol)
+				 << "\", \"symbol_bytes\": " << r.symbol.size() << ", \"color\": \"" << r.color << "\", \"length\": " << r.length
+				 << ", \"calls\": " << r.calls << ", \"glyphs_per_sec\": " << r.glyphsPerSec << ", \"bytes_per_call\": " << r.bytesPerCall
+				 << ", \"allocs_per_call\": ";
+			if (alloc_stats::enabled) json << r.allocsPerCall << ", \"alloc_bytes_per_call\": " << r.allocBytesPerCall;
+			else json << "null, \"alloc_bytes_per_call\": null";
+			json << ", \"latency_us\": {\"p50\": " << r.p50 << ", \"p90\": " << r.p90 << ", \"p99\": " << r.p99 << ", \"max\": " << r.max
+				 << "}}" << (i + 1 < results.size() ? ",\n" : "\n");
+		}
+		json << "  ]\n}\n";
+		cout << "results: " << jsonPath << '\n';
+	}
+	return 0;
+}
+
+// глифов/с для кадра одним цветом и с градиентами по строкам и по столбцам
+int benchColor(size_t length) {
+	const string alphabet = "The quick brown fox jumps over the lazy dog ";
+	string text;
+	while (text.size() < length) text += alphabet;
+	text.resize(length);
+	const Gradient rows{Paint::rgb(255, 0, 0), Paint::rgb(0, 0, 255), Gradient::Direction::ROWS};
+	const Gradient columns{Paint::rgb(255, 0, 0), Paint::rgb(0, 0, 255), Gradient::Direction::COLUMNS};
+
+	auto glyphsPerSec = [&](auto&& render) {
+		size_t bytes = render().size();
+		const int repeats = 20;
+		auto start = chrono::steady_clock::now();
+		for (int r = 0; r < repeats; r++) bytes = render().size();
+		double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+		cout << static_cast<long long>(repeats * text.size() / seconds) << " glyphs/s, " << bytes << " bytes/frame\n";
+	};
+	cout << "flat 8-color:    ";
+	glyphsPerSec([&] { return Printer::renderFrame(text, Color::GREEN, "#"); });
+	cout << "flat 256-color:  ";
+	glyphsPerSec([&] { return Printer::renderFrame(text, Paint::indexed(208), "#"); });
+	cout << "flat truecolor:  ";
+	glyphsPerSec([&] { return Printer::renderFrame(text, Paint::rgb(255, 136, 0), "#"); });
+	cout << "row gradient:    ";
+	glyphsPerSec([&] { return Printer::renderFrame(text, rows, "#"); });
+	cout << "column gradient: ";
+	glyphsPerSec([&] { return Printer::renderFrame(text, columns, "#"); });
+	return 0;
+}
+
+// main --export ppm|png|html входной_файл каталог [шрифт] [цвет] [масштаб]:
+// каждая строка файла - отдельный баннер, строки раскладываются по всем ядрам
+int exportBatch(const string& formatName, const string& inputPath, const string& outDir, const string& fontId, Paint color, int scale) {
+	ExportFormat format = formatName == "ppm" ? ExportFormat::PPM : formatName == "png" ? ExportFormat::PNG : ExportFormat::HTML;
+	ifstream in(inputPath);
+	if (!in.is_open()) {
+		cerr << "Не удалось открыть " << inputPath << endl;
+		return 1;
+	}
+	vector<string> lines;
+	for (string line; getline(in, line);) {
+		if (!line.empty() && line.back() == '\r') line.pop_back();
+		lines.push_back(line);
+	}
+	error_code ec;
+	filesystem::create_directories(outDir, ec);
+	FontLoader::loadFont(fontId);
+
+	atomic<size_t> next{0};
+	atomic<size_t> failed{0}, bytes{0};
+	const unsigned threadCount = max(1u, thread::hardware_concurrency());
+	auto start = chrono::steady_clock::now();
+	vector<thread> workers;
+	for (unsigned t = 0; t < threadCount; t++) {
+		workers.emplace_back([&] {
+			for (size_t i = next++; i < lines.size(); i = next++) {
+				const string image = Printer::exportBanner(lines[i], format, color, "#", fontId, scale);
+				const string path = (filesystem::path(outDir) / ("banner_" + to_string(i) + "." + BannerExporter::extension(format))).string();
+				ofstream out(path, ios::binary | ios::trunc);
+				out.write(image.data(), static_cast<streamsize>(image.size()));
+				if (!out) failed++;
+				bytes += image.size();
+			}
+		});
+	}
+	for (thread& worker : workers) worker.join();
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	cout << lines.size() << " images (" << bytes.load() / 1024 << " KB) in " << seconds << " s on " << threadCount
+		 << " threads: " << (seconds > 0 ? lines.size() / seconds : 0) << " images/s, " << failed.load() << " failed\n";
+	return failed.load() == 0 ? 0 : 1;
+}
+
+// развертка строк баннера в символы: посимвольная замена в строках ячеек против таблицы по битовым маскам
+int benchExpand(size_t length) {
+	const string alphabet = "The quick brown fox jumps over the lazy dog ";
+	string text;
+	while (text.size() < length) text += alphabet;
+	text.resize(length);
+
+	for (const string symbol : {"#", "¤", "▓", "█"}) {
+		auto cellsPath = [&] { // как раньше: composeRows + замена по одной ячейке
+			string frame;
+			for (const string& row : Printer::composeRows(text, "1")) {
+				Printer::appendSymbols(frame, row.data(), row.size(), symbol);
+				frame += '\n';
+			}
+			return frame;
+		};
+		auto maskPath = [&] {
+			const Font& font = FontLoader::getFont("1");
+			const SymbolExpander& expander = SymbolExpander::forSymbol(symbol);
+			size_t rowCells = 0;
+			for (char raw : text) rowCells += font.glyph(static_cast<unsigned char>(raw)).width + 1;
+			string frame;
+			for (int r = 0; r < font.height(); r++) {
+				const size_t begin = frame.size();
+				frame.resize(begin + rowCells * expander.symbolSize() + expander.slack());
+				char* out = &frame[begin];
+				for (char raw : text) {
+					const Font::Glyph& glyph = font.glyph(static_cast<unsigned char>(raw));
+					out = expander.expand(out, font.mask(glyph, r), glyph.width);
+					*out++ = ' ';
+				}
+				frame.resize(static_cast<size_t>(out - frame.data()));
+				frame += '\n';
+			}
+			return frame;
+		};
+		if (cellsPath() != maskPath()) {
+			cerr << "развертка по маскам не совпадает для символа " << symbol << endl;
+			return 1;
+		}
+		auto nsPerGlyph = [&](auto&& body) {
+			const int repeats = 20;
+			size_t bytes = 0;
+			auto start = chrono::steady_clock::now();
+			for (int r = 0; r < repeats; r++) bytes += body().size();
+			(void)bytes;
+			return chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / (repeats * static_cast<double>(text.size()));
+		};
+		double cells = nsPerGlyph(cellsPath), masks = nsPerGlyph(maskPath);
+		cout << symbol << " (" << symbol.size() << " byte): cells " << cells << " ns/glyph, masks " << masks << " ns/glyph\n";
+	}
+	return 0;
+}
+
+// main --stream [шрифт] [символ] [цвет] [--stats] [--watch] < input
+int streamStdin(const string& fontId, const string& symbol, Paint color, bool stats, bool watch) {
+	ios::sync_with_stdio(false);
+	unique_ptr<FontWatcher> watcher;
+	if (watch) watcher = make_unique<FontWatcher>(); // правки textN.txt видны со следующей строки баннера
+	StreamPrinter printer(color, symbol, fontId);
+	vector<char> chunk(1 << 16);
+	size_t bytesIn = 0;
+	auto start = chrono::steady_clock::now();
+	while (cin.read(chunk.data(), static_cast<streamsize>(chunk.size())) || cin.gcount() > 0) {
+		size_t got = static_cast<size_t>(cin.gcount());
+		printer.feed(chunk.data(), got);
+		bytesIn += got;
+	}
+	printer.finish();
+
+	if (stats) {
+		double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+		cerr << bytesIn << " bytes in, " << printer.linesPrinted() << " banner lines, " << seconds << " s, "
+			 << (seconds > 0 ? bytesIn / seconds / (1024 * 1024) : 0) << " MB/s, peak RSS " << peakRssKb() << " KB\n";
+	}
+	return 0;
+}
+
+// ns/символ: поиск глифа в map (toupper + find) против плоской таблицы, и полная сборка строк баннера
+int benchLookup(size_t length) {
+	auto repeatTo = [length](const string& alphabet) {
+		string text;
+		text.reserve(length + alphabet.size());
+		while (text.size() < length) text += alphabet;
+		return text;
+	};
+	const string ascii = repeatTo("The quick brown fox jumps over the lazy dog 0123456789 ");
+	const string cyrillic = repeatTo("Съешь же ещё этих мягких французских булок, да выпей чаю ");
+
+	for (const string fontId : {"1", "2"}) {
+		const FontTemplates templates = FontLoader::readTemplates(fontId);
+		const Font& font = FontLoader::getFont(fontId);
+		for (const string* text : {&ascii, &cyrillic}) {
+			size_t chars = 0;
+			forEachCodePoint(*text, [&](char32_t) { chars++; });
+			auto nsPerChar = [&](auto&& body) {
+				body(); // прогрев
+				auto start = chrono::steady_clock::now();
+				const int repeats = 5;
+				for (int r = 0; r < repeats; r++) body();
+				return chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / (repeats * static_cast<double>(chars));
+			};
+			volatile size_t sink = 0;
+
+			double mapNs = nsPerChar([&] {
+				size_t width = 0;
+				forEachCodePoint(*text, [&](char32_t cp) {
+					auto it = templates.find(foldCase(cp));
+					if (it != templates.end()) width += it->second.front().size();
+				});
+				sink = width;
+			});
+			double flatNs = nsPerChar([&] {
+				size_t width = 0;
+				forEachCodePoint(*text, [&](char32_t cp) { width += font.glyph(cp).width; });
+				sink = width;
+			});
+			double composeNs = nsPerChar([&] { sink = Printer::composeRows(*text, fontId).front().size(); });
+			(void)sink;
+
+			cout << "font " << fontId << ", " << chars << (text == &ascii ? " ASCII" : " Cyrillic") << " chars: map lookup " << mapNs
+				 << " ns/char, flat table " << flatNs << " ns/char, composeRows " << composeNs << " ns/char\n";
+		}
+	}
+	return 0;
+}
+
+int main(int argc, char* argv[]) {
+	// main --compile-font 1 2 : text1.txt, text2.txt -> text1.fnt, text2.fnt
+	if (argc > 1 && string(argv[1]) == "--compile-font") {
+		int failed = 0;
+		for (int i = 2; i < argc; i++) {
+			if (CompiledFont::compile(argv[i])) {
+				cout << CompiledFont::textPath(argv[i]) << " -> " << CompiledFont::binaryPath(argv[i]) << '\n';
+			} else {
+				failed++;
+			}
+		}
+		return failed == 0 ? 0 : 1;
+	}
+	// main --gen-builtin 1 2 > fonts_builtin.hpp : встроить шрифты в программу
+	if (argc > 1 && string(argv[1]) == "--gen-builtin") {
+		return generateBuiltinHeader(vector<string>(argv + 2, argv + argc), cout) ? 0 : 1;
+	}
+	// main --stream [шрифт] [символ] [цвет] [--stats] [--watch] < input
+	if (argc > 1 && string(argv[1]) == "--stream") {
+		vector<string> args(argv + 2, argv + argc);
+		bool stats = find(args.begin(), args.end(), "--stats") != args.end();
+		bool watch = find(args.begin(), args.end(), "--watch") != args.end();
+		args.erase(remove(args.begin(), args.end(), "--stats"), args.end());
+		args.erase(remove(args.begin(), args.end(), "--watch"), args.end());
+		return streamStdin(args.size() > 0 ? args[0] : "1", args.size() > 1 ? args[1] : "*",
+						   args.size() > 2 ? stringToPaint(args[2]) : Paint(Color::WHITE), stats, watch);
+	}
+	// main --animate marquee|blink|typewriter текст [fps] [секунд] [шрифт] [символ] [цвет]
+	if (argc > 1 && string(argv[1]) == "--animate") {
+		return animateBanner(vector<string>(argv + 2, argv + argc));
+	}
+	// main --bench-dashboard [кадров] [потоков]
+	if (argc > 1 && string(argv[1]) == "--bench-dashboard") {
+		return benchDashboard(argc > 2 ? atoi(argv[2]) : 1000, argc > 3 ? static_cast<unsigned>(atoi(argv[3])) : thread::hardware_concurrency());
+	}
+	// main --stress-compositor [повторов] [потоков]
+	if (argc > 1 && string(argv[1]) == "--stress-compositor") {
+		return stressCompositor(argc > 2 ? atoi(argv[2]) : 200, argc > 3 ? static_cast<unsigned>(atoi(argv[3])) : max(4u, thread::hardware_concurrency()));
+	}
+	// main --stress-reload [потоков] [секунд]
+	if (argc > 1 && string(argv[1]) == "--stress-reload") {
+		return stressReload(argc > 2 ? atoi(argv[2]) : 4, argc > 3 ? atoi(argv[3]) : 3);
+	}
+	// main --bench-layout [кадров]
+	if (argc > 1 && string(argv[1]) == "--bench-layout") {
+		return benchLayout(argc > 2 ? atoi(argv[2]) : 2000);
+	}
+	// main --bench-color [символов]
+	if (argc > 1 && string(argv[1]) == "--bench-color") {
+		return benchColor(argc > 2 ? static_cast<size_t>(atol(argv[2])) : 2000);
+	}
+	// main --export ppm|png|html input.txt out_dir [шрифт] [цвет] [масштаб]
+	if (argc > 4 && string(argv[1]) == "--export") {
+		return exportBatch(argv[2], argv[3], argv[4], argc > 5 ? argv[5] : "1", argc > 6 ? stringToPaint(argv[6]) : Paint(Color::WHITE),
+						   argc > 7 ? atoi(argv[7]) : 4);
+	}
+	// main --bench [results.json] : весь набор бенчмарков отрисовки
+	if (argc > 1 && string(argv[1]) == "--bench") {
+		return benchSuite(argc > 2 ? argv[2] : "");
+	}
+	// main --bench-expand [символов]
+	if (argc > 1 && string(argv[1]) == "--bench-expand") {
+		return benchExpand(argc > 2 ? static_cast<size_t>(atol(argv[2])) : 100000);
+	}
+	// main --bench-lookup [символов]
+	if (argc > 1 && string(argv[1]) == "--bench-lookup") {
+		return benchLookup(argc > 2 ? static_cast<size_t>(atol(argv[2])) : 1000000);
+	}
+	// main --stress-fonts [потоки] [итерации]
+	if (argc > 1 && string(argv[1]) == "--stress-fonts") {
+		return stressFonts(argc > 2 ? atoi(argv[2]) : 32, argc > 3 ? atoi(argv[3]) : 2000);
+	}
 
-int main() {
 	// Настройка локали для поддержки UTF-8
 	#ifdef _WIN32
 		// Для Windows: установка UTF-8 кодовой страницы
@@ -259,14 +3367,14 @@ int main() {
 
 	// Демонстрация через экземпляр
 	cout << "object demonstration\n";
-	cout << "input the word(latin): ";
+	cout << "input the word(latin or cyrillic): ";
 	string userInput;
 	getline(cin, userInput);
 
-	cout << "choose color(BLACK, RED, GREEN, YELLOW, BLUE, MAGENTA, CYAN, WHITE): ";
+	cout << "choose color(BLACK, RED, GREEN, YELLOW, BLUE, MAGENTA, CYAN, WHITE, #RRGGBB or 0-255): ";
 	string colorInput;
 	getline(cin, colorInput);
-	Color color = stringToColor(colorInput);
+	Paint color = stringToPaint(colorInput);
 
 	cout << "choose symbol (can be UTF-8, e.g. *, #, █, ▓, ╬, ║, etc.): ";
 	string symbol = "*";
@@ -293,6 +3401,8 @@ int main() {
 	{
 		Printer printer(color, {10, 10}, symbol, fontChoice);
 		printer.print(userInput);
+		const auto& stats = printer.lastFrameStats();
+		cout << "frame: " << stats.bytesEmitted << " bytes, saved " << stats.bytesSaved() << " vs full redraw\n";
 	}
 
 	cout << "\nconsole state back to normal.\n";
@@ -1,11 +1,259 @@
 #include <regex>
 #include <iostream>
 #include <fstream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <bitset>
+#include <unordered_map>
+#include <random>
+#include <cstdio>
+#include <cstdlib>
+#include <csignal>
+#include <cstring>
+#include <stdexcept>
+#include <variant>
+#include <type_traits>
+#include <initializer_list>
+#include <functional>
+#include <filesystem>
+#include <cerrno>
+#include <climits>
+#if __cplusplus >= 202002L
+#include <span>
+#endif
+#ifndef _WIN32
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#endif
+#ifdef __linux__
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#endif
+
+//уровни по возрастанию важности
+enum class LogLevel : uint8_t { TRACE, DEBUG, INFO, WARNING, ERROR, FATAL };
+
+inline const char* levelName(LogLevel level) {
+    static const char* names[] = {"TRACE", "DEBUG", "INFO", "WARNING", "ERROR", "FATAL"};
+    return names[static_cast<int>(level)];
+}
+
+//место в коде, откуда пришла запись; заполняет LOG_HERE
+struct SourceLocation {
+    const char* file;
+    int line;
+    const char* function;
+};
+
+#define LOG_HERE SourceLocation{__FILE__, __LINE__, __func__}
+
+//поле записи: ключ (строковый литерал) и типизированное значение
+struct Field {
+    const char* key;
+    std::variant<int64_t, double, bool, std::string> value;
+
+    template<typename T, typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value, int>::type = 0>
+    Field(const char* key, T value): key(key), value(static_cast<int64_t>(value)) {}
+    Field(const char* key, double value): key(key), value(value) {}
+    Field(const char* key, bool value): key(key), value(value) {}
+    Field(const char* key, const char* value): key(key), value(std::string(value)) {}
+    Field(const char* key, std::string value): key(key), value(std::move(value)) {}
+
+    bool operator==(const Field& other) const { return std::strcmp(key, other.key) == 0 && value == other.value; }
+};
+
+//структурированная запись: текст собирается только когда он понадобится обработчику или текстовому фильтру.
+//Кэш текста не синхронизирован - одну запись не форматируют из нескольких потоков одновременно
+class Record {
+    mutable std::string textCache;      //сообщение и поля
+    mutable std::string formattedCache; //вся строка: время, уровень, место, сообщение, поля
+
+    static void appendNumber(std::string& out, long value, int width) {
+        std::string digits = std::to_string(value);
+        if (digits.size() < static_cast<size_t>(width)) out.append(width - digits.size(), '0');
+        out += digits;
+    }
+
+    //UTC без gmtime: у него общий статический буфер
+    static void appendTime(std::string& out, std::chrono::system_clock::time_point time) {
+        long long millis = std::chrono::duration_cast<std::chrono::milliseconds>(time.time_since_epoch()).count();
+        long long days = millis / 86400000, rest = millis % 86400000;
+        if (rest < 0) { rest += 86400000; days--; }
+        //дни с 1970-01-01 в дату григорианского календаря
+        days += 719468;
+        long long era = (days >= 0 ? days : days - 146096) / 146097;
+        long long dayOfEra = days - era * 146097;
+        long long yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+        long long dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+        long long monthIndex = (5 * dayOfYear + 2) / 153;
+        long long day = dayOfYear - (153 * monthIndex + 2) / 5 + 1;
+        long long month = monthIndex < 10 ? monthIndex + 3 : monthIndex - 9;
+        long long year = yearOfEra + era * 400 + (month <= 2);
+        appendNumber(out, static_cast<long>(year), 4); out += '-';
+        appendNumber(out, static_cast<long>(month), 2); out += '-';
+        appendNumber(out, static_cast<long>(day), 2); out += ' ';
+        appendNumber(out, static_cast<long>(rest / 3600000), 2); out += ':';
+        appendNumber(out, static_cast<long>(rest / 60000 % 60), 2); out += ':';
+        appendNumber(out, static_cast<long>(rest / 1000 % 60), 2); out += '.';
+        appendNumber(out, static_cast<long>(rest % 1000), 3);
+    }
+
+    static void appendValue(std::string& out, const Field& field) {
+        if (const int64_t* number = std::get_if<int64_t>(&field.value)) out += std::to_string(*number);
+        else if (const double* real = std::get_if<double>(&field.value)) out += std::to_string(*real);
+        else if (const bool* flag = std::get_if<bool>(&field.value)) out += *flag ? "true" : "false";
+        else out += std::get<std::string>(field.value);
+    }
+
+public:
+    //"2024-05-01 12:00:00.123", UTC
+    static std::string formatTime(std::chrono::system_clock::time_point time) {
+        std::string out;
+        appendTime(out, time);
+        return out;
+    }
+
+    LogLevel level;
+    std::chrono::system_clock::time_point time;
+    SourceLocation where;
+    std::string message;
+    std::vector<Field> fields;
+    bool plain = false; //простая строка из log(std::string): без уровня, времени и места, текст - само сообщение
+
+    Record(LogLevel level, SourceLocation where, std::string message, std::initializer_list<Field> fields = {})
+        : level(level), time(std::chrono::system_clock::now()), where(where), message(std::move(message)), fields(fields) {}
+
+    explicit Record(std::string text = std::string())
+        : level(LogLevel::INFO), where{"", 0, ""}, message(std::move(text)), plain(true) {}
+
+    const Field* field(const char* key) const {
+        for (const Field& field : fields) if (std::strcmp(field.key, key) == 0) return &field;
+        return nullptr;
+    }
+
+    //"сообщение key=value ..." - то, что видят текстовые фильтры
+    const std::string& text() const {
+        if (fields.empty()) return message;
+        if (textCache.empty()) {
+            textCache = message;
+            for (const Field& field : fields) {
+                textCache += ' ';
+                textCache += field.key;
+                textCache += '=';
+                appendValue(textCache, field);
+            }
+        }
+        return textCache;
+    }
+
+    //"2024-05-01 12:00:00.123 ERROR file.cpp:42 сообщение key=value" - то, что пишут обработчики
+    const std::string& formatted() const {
+        if (plain) return message;
+        if (formattedCache.empty()) {
+            appendTime(formattedCache, time);
+            formattedCache += ' ';
+            formattedCache += levelName(level);
+            formattedCache += ' ';
+            const char* file = where.file;
+            for (const char* c = where.file; *c; c++) if (*c == '/' || *c == '\\') file = c + 1;
+            formattedCache += file;
+            formattedCache += ':';
+            formattedCache += std::to_string(where.line);
+            formattedCache += ' ';
+            formattedCache += text();
+        }
+        return formattedCache;
+    }
+};
+
+//несколько записей подряд; в C++17 std::span нет - минимальная замена с тем же интерфейсом
+#if __cplusplus >= 202002L
+using RecordSpan = std::span<const Record>;
+#else
+class RecordSpan {
+    const Record* first = nullptr;
+    size_t count = 0;
+public:
+    RecordSpan() = default;
+    RecordSpan(const Record* first, size_t count): first(first), count(count) {}
+    template<typename Container>
+    RecordSpan(const Container& records): first(records.data()), count(records.size()) {}
+
+    const Record* data() const { return first; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    const Record& operator[](size_t i) const { return first[i]; }
+    const Record* begin() const { return first; }
+    const Record* end() const { return first + count; }
+    RecordSpan subspan(size_t offset, size_t length) const { return RecordSpan(first + offset, length); }
+};
+#endif
+
+//счетчик системных вызовов записи у обработчиков - для замеров
+namespace io_stats {
+    inline std::atomic<size_t> writes{0};
+}
+
+#ifndef _WIN32
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+//writev всего списка частей: не больше IOV_MAX частей за вызов, недописанный хвост дописывается.
+//Возвращает, сколько байт так и не записано из-за ошибки (0 - записано все)
+inline size_t writeAll(int fd, std::vector<iovec>& parts) {
+    size_t first = 0;
+    while (first < parts.size()) {
+        int count = static_cast<int>(std::min<size_t>(parts.size() - first, IOV_MAX));
+        ssize_t written = ::writev(fd, &parts[first], count);
+        io_stats::writes.fetch_add(1, std::memory_order_relaxed);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            size_t left = 0;
+            for (; first < parts.size(); first++) left += parts[first].iov_len;
+            return left;
+        }
+        size_t left = static_cast<size_t>(written);
+        while (first < parts.size() && left >= parts[first].iov_len) {
+            left -= parts[first].iov_len;
+            first++;
+        }
+        if (left > 0) {
+            parts[first].iov_base = static_cast<char*>(parts[first].iov_base) + left;
+            parts[first].iov_len -= left;
+        }
+    }
+    return 0;
+}
+
+inline void addPart(std::vector<iovec>& parts, const char* data, size_t size) {
+    parts.push_back(iovec{const_cast<char*>(data), size});
+}
+#endif
 
 //интерфейс - определяет нужно ли нам логировать это сообщение или нет 
 class ILogFilter {
 public: 
     virtual bool match(const std::string& text) const = 0;
+    //структурированная запись; по умолчанию - текст сообщения с полями
+    virtual bool matchRecord(const Record& record) const { return match(record.text()); }
     virtual ~ILogFilter() = default;
 };
 
@@ -20,14 +268,597 @@ public:
     }
 };
 
+//много подстрок сразу: автомат Ахо-Корасик, один проход по тексту вместо find для каждого шаблона.
+//Переходы хранятся плоской таблицей [состояние][класс байта], байты, которых нет в шаблонах, - один класс
+class MultiPatternLogFilter: public ILogFilter {
+    uint8_t byteClass[256] = {};
+    uint32_t classes = 1;
+    std::vector<uint32_t> next;      //смещение строки следующего состояния (номер * classes)
+    uint32_t firstTerminal = 0;      //смещение первого состояния, где заканчивается шаблон; они идут последними
+    bool matchesEverything = false;  //есть пустой шаблон
+
+public:
+    MultiPatternLogFilter(const std::vector<std::string>& patterns) {
+        for (const std::string& pattern : patterns) {
+            if (pattern.empty()) matchesEverything = true;
+            for (unsigned char c : pattern) {
+                //если в шаблонах встречаются все 256 байт, последнему достается свободный класс 0
+                if (byteClass[c] == 0 && classes < 256) byteClass[c] = static_cast<uint8_t>(classes++);
+            }
+        }
+
+        //бор: goTo[state * classes + cls], 0 - перехода нет (в корень вернуться по бору нельзя)
+        std::vector<uint32_t> goTo(classes, 0);
+        std::vector<char> terminal(1, 0);
+        for (const std::string& pattern : patterns) {
+            uint32_t state = 0;
+            for (unsigned char c : pattern) {
+                uint32_t& edge = goTo[state * classes + byteClass[c]];
+                if (edge == 0) {
+                    edge = static_cast<uint32_t>(terminal.size());
+                    terminal.push_back(0);
+                    goTo.resize(goTo.size() + classes, 0);
+                }
+                state = goTo[state * classes + byteClass[c]];
+            }
+            terminal[state] = 1;
+        }
+
+        //обход в ширину: суффиксные ссылки и достраивание переходов до полного автомата
+        uint32_t states = static_cast<uint32_t>(terminal.size());
+        std::vector<uint32_t> fail(states, 0);
+        std::deque<uint32_t> queue;
+        for (uint32_t cls = 0; cls < classes; cls++) {
+            if (goTo[cls] != 0) queue.push_back(goTo[cls]);
+        }
+        while (!queue.empty()) {
+            uint32_t state = queue.front();
+            queue.pop_front();
+            if (terminal[fail[state]]) terminal[state] = 1; //шаблон заканчивается и в суффиксе
+            for (uint32_t cls = 0; cls < classes; cls++) {
+                uint32_t& edge = goTo[state * classes + cls];
+                if (edge != 0) {
+                    fail[edge] = goTo[fail[state] * classes + cls];
+                    queue.push_back(edge);
+                } else {
+                    edge = goTo[fail[state] * classes + cls];
+                }
+            }
+        }
+
+        //перенумеровываем: конечные состояния в конец, тогда проверка - одно сравнение
+        std::vector<uint32_t> order(states);
+        uint32_t id = 0;
+        for (uint32_t state = 0; state < states; state++) if (!terminal[state]) order[state] = id++;
+        firstTerminal = id * classes;
+        for (uint32_t state = 0; state < states; state++) if (terminal[state]) order[state] = id++;
+        next.assign(static_cast<size_t>(states) * classes, 0);
+        for (uint32_t state = 0; state < states; state++) {
+            for (uint32_t cls = 0; cls < classes; cls++) {
+                next[order[state] * classes + cls] = order[goTo[state * classes + cls]] * classes;
+            }
+        }
+        if (terminal[0]) matchesEverything = true;
+    }
+
+    bool match(const std::string& text) const override {
+        if (matchesEverything) return true;
+        const uint32_t* table = next.data();
+        uint32_t state = 0;
+        for (unsigned char c : text) {
+            state = table[state + byteClass[c]];
+            if (state >= firstTerminal) return true;
+        }
+        return false;
+    }
+
+    size_t stateCount() const { return next.size() / classes; }
+};
+
+//регулярные выражения без возвратов: подмножество ECMAScript (литералы, ., классы, \d \w \s, группы, |, * + ? {n,m}, ^ $)
+//компилируется в НКА Томпсона, по которому ДКА строится лениво - состояние появляется, когда текст в него пришел
+class RegexDfa {
+    struct Unsupported {}; //конструкция вне подмножества - ReLogFilter возьмет std::regex
+
+    struct Ast {
+        enum Kind { SET, CONCAT, ALT, REPEAT, BEGIN, END } kind;
+        std::bitset<256> set;
+        std::vector<Ast> children;
+        int min = 0, max = -1; //max == -1 - без ограничения
+    };
+
+    struct Node {
+        enum Type { SET, SPLIT, EMPTY, BEGIN, END, MATCH } type;
+        int out = -1, out2 = -1;
+        std::bitset<256> set;
+    };
+
+    //состояние ДКА - множество состояний НКА (SET и END), переходы заполняются по мере надобности.
+    //nfa меняется и читается только под mutex, остальное читается без блокировок
+    struct DfaState {
+        std::vector<int> nfa;
+        std::atomic<bool> acceptAtEnd{false};
+        std::atomic<const DfaState*> next[256] = {};
+    };
+
+    static constexpr size_t MAX_NODES = 10000;
+    static constexpr size_t MAX_STATES = 4096; //больше - кэш сбрасывается и строится заново
+
+    const std::string pattern;
+    size_t pos = 0;
+    std::vector<Node> nodes;
+    int start = 0;
+    std::string prefix;    //с этих байт начинается любое совпадение
+    bool anchored = false; //выражение начинается с ^
+
+    mutable std::mutex mutex; //только для достраивания и сброса ДКА
+    mutable std::unordered_map<std::string, DfaState*> states;  //состояния текущего поколения кэша
+    mutable std::vector<std::unique_ptr<DfaState>> pool;       //не освобождаются: после сброса занимаются заново
+    mutable std::atomic<uint64_t> epoch{0};                    //поколение кэша, растет при сбросе
+    mutable size_t flushes = 0;
+    std::unique_ptr<DfaState> initial;   //начало текста: ^ выполняется
+    std::unique_ptr<DfaState> restart;   //поиск с середины текста
+    std::unique_ptr<DfaState> matched{new DfaState}, dead{new DfaState}; //метки: совпадение найдено / больше не найдется
+
+    static std::bitset<256> single(unsigned char c) {
+        std::bitset<256> set;
+        set.set(c);
+        return set;
+    }
+
+    static std::bitset<256> range(int lo, int hi) {
+        std::bitset<256> set;
+        for (int c = lo; c <= hi; c++) set.set(c);
+        return set;
+    }
+
+    static Ast leaf(Ast::Kind kind, const std::bitset<256>& set = {}) {
+        Ast ast{kind, set, {}};
+        return ast;
+    }
+
+    bool more() const { return pos < pattern.size(); }
+    char peek() const { return pattern[pos]; }
+
+    //\d \w \s и их отрицания; false - не классовый escape
+    static bool classEscape(char c, std::bitset<256>& set) {
+        switch (c) {
+        case 'd': case 'D': set = range('0', '9'); break;
+        case 'w': case 'W': set = range('0', '9') | range('a', 'z') | range('A', 'Z') | single('_'); break;
+        case 's': case 'S': set = single(' ') | range('\t', '\r'); break;
+        default: return false;
+        }
+        if (c >= 'A' && c <= 'Z') set.flip();
+        return true;
+    }
+
+    unsigned char charEscape(char c) {
+        switch (c) {
+        case 't': return '\t';
+        case 'n': return '\n';
+        case 'r': return '\r';
+        case 'f': return '\f';
+        case 'v': return '\v';
+        case '0':
+            if (more() && peek() >= '0' && peek() <= '9') throw Unsupported();
+            return '\0';
+        }
+        if ((c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')) throw Unsupported(); //\b, \1, \x, \u ...
+        return static_cast<unsigned char>(c);
+    }
+
+    Ast parseClass() {
+        bool negate = more() && peek() == '^';
+        if (negate) pos++;
+        if (more() && peek() == ']') throw Unsupported(); //[] и [^] в разных движках значат разное
+        std::bitset<256> set;
+        for (;;) {
+            if (!more()) throw Unsupported();
+            char c = pattern[pos++];
+            if (c == ']') break;
+            std::bitset<256> escaped;
+            unsigned char lo;
+            if (c == '\\') {
+                if (!more()) throw Unsupported();
+                char e = pattern[pos++];
+                if (e == 'b') throw Unsupported();
+                if (classEscape(e, escaped)) {
+                    set |= escaped;
+                    continue;
+                }
+                lo = charEscape(e);
+            } else {
+                if (c == '[' && more() && (peek() == ':' || peek() == '.' || peek() == '=')) throw Unsupported();
+                lo = static_cast<unsigned char>(c);
+            }
+            if (pos + 1 < pattern.size() && peek() == '-' && pattern[pos + 1] != ']') {
+                pos++;
+                char h = pattern[pos++];
+                unsigned char hi;
+                if (h == '\\') {
+                    if (!more() || classEscape(peek(), escaped)) throw Unsupported();
+                    hi = charEscape(pattern[pos++]);
+                } else {
+                    hi = static_cast<unsigned char>(h);
+                }
+                if (lo > hi || hi >= 0x80) throw Unsupported(); //диапазоны по байтам старше 0x7F знаковый char сравнивает иначе
+                set |= range(lo, hi);
+            } else {
+                set.set(lo);
+            }
+        }
+        if (negate) set.flip();
+        return leaf(Ast::SET, set);
+    }
+
+    Ast parseAtom() {
+        char c = pattern[pos++];
+        switch (c) {
+        case '(': {
+            if (more() && peek() == '?') {
+                if (pos + 1 < pattern.size() && pattern[pos + 1] == ':') pos += 2;
+                else throw Unsupported(); //просмотр вперед
+            }
+            Ast inner = parseAlt();
+            if (!more() || peek() != ')') throw Unsupported();
+            pos++;
+            return inner;
+        }
+        case '[': return parseClass();
+        case '.': return leaf(Ast::SET, ~(single('\n') | single('\r')));
+        case '^': return leaf(Ast::BEGIN);
+        case '$': return leaf(Ast::END);
+        case '\\': {
+            if (!more()) throw Unsupported();
+            char e = pattern[pos++];
+            std::bitset<256> set;
+            if (classEscape(e, set)) return leaf(Ast::SET, set);
+            return leaf(Ast::SET, single(charEscape(e)));
+        }
+        case ')': case '*': case '+': case '?': case '{': case '}': case ']':
+            throw Unsupported();
+        }
+        return leaf(Ast::SET, single(static_cast<unsigned char>(c)));
+    }
+
+    int parseNumber() {
+        if (!more() || peek() < '0' || peek() > '9') throw Unsupported();
+        int value = 0;
+        while (more() && peek() >= '0' && peek() <= '9') {
+            value = value * 10 + (pattern[pos++] - '0');
+            if (value > 1000) throw Unsupported();
+        }
+        return value;
+    }
+
+    Ast parseRepeat() {
+        Ast atom = parseAtom();
+        if (!more()) return atom;
+        int min, max;
+        switch (peek()) {
+        case '*': min = 0; max = -1; pos++; break;
+        case '+': min = 1; max = -1; pos++; break;
+        case '?': min = 0; max = 1; pos++; break;
+        case '{':
+            pos++;
+            min = max = parseNumber();
+            if (more() && peek() == ',') {
+                pos++;
+                max = more() && peek() == '}' ? -1 : parseNumber();
+            }
+            if (!more() || peek() != '}' || (max != -1 && max < min)) throw Unsupported();
+            pos++;
+            break;
+        default:
+            return atom;
+        }
+        if (atom.kind == Ast::BEGIN || atom.kind == Ast::END) throw Unsupported();
+        if (more() && peek() == '?') pos++; //ленивый квантификатор: для "есть ли совпадение" разницы нет
+        Ast repeat{Ast::REPEAT, {}, {atom}, min, max};
+        return repeat;
+    }
+
+    Ast parseConcat() {
+        Ast concat{Ast::CONCAT, {}, {}};
+        while (more() && peek() != '|' && peek() != ')') concat.children.push_back(parseRepeat());
+        return concat;
+    }
+
+    Ast parseAlt() {
+        Ast alt{Ast::ALT, {}, {parseConcat()}};
+        while (more() && peek() == '|') {
+            pos++;
+            alt.children.push_back(parseConcat());
+        }
+        return alt.children.size() == 1 ? alt.children[0] : alt;
+    }
+
+    int addNode(Node::Type type, int out, int out2 = -1, const std::bitset<256>& set = {}) {
+        if (nodes.size() >= MAX_NODES) throw Unsupported();
+        nodes.push_back(Node{type, out, out2, set});
+        return static_cast<int>(nodes.size() - 1);
+    }
+
+    //строим с конца: возвращает вход фрагмента, который после себя переходит в next
+    int compileAst(const Ast& ast, int next) {
+        switch (ast.kind) {
+        case Ast::SET: return addNode(Node::SET, next, -1, ast.set);
+        case Ast::BEGIN: return addNode(Node::BEGIN, next);
+        case Ast::END: return addNode(Node::END, next);
+        case Ast::CONCAT:
+            for (auto child = ast.children.rbegin(); child != ast.children.rend(); ++child) next = compileAst(*child, next);
+            return next;
+        case Ast::ALT: {
+            int entry = compileAst(ast.children.back(), next);
+            for (size_t i = ast.children.size() - 1; i-- > 0;) entry = addNode(Node::SPLIT, compileAst(ast.children[i], next), entry);
+            return entry;
+        }
+        case Ast::REPEAT: {
+            const Ast& body = ast.children[0];
+            int entry = next;
+            if (ast.max == -1) {
+                int loop = addNode(Node::SPLIT, -1, next);
+                int inner = compileAst(body, loop);
+                nodes[loop].out = inner;
+                entry = loop;
+            } else {
+                for (int i = ast.min; i < ast.max; i++) entry = addNode(Node::SPLIT, compileAst(body, entry), next);
+            }
+            for (int i = 0; i < ast.min; i++) entry = compileAst(body, entry);
+            return entry;
+        }
+        }
+        return next;
+    }
+
+    //обязательный литеральный префикс: подряд идущие одиночные символы в начале
+    void findPrefix(const Ast& ast) {
+        std::vector<const Ast*> items;
+        if (ast.kind == Ast::CONCAT) for (const Ast& child : ast.children) items.push_back(&child);
+        else items.push_back(&ast);
+        size_t i = 0;
+        if (i < items.size() && items[i]->kind == Ast::BEGIN) {
+            anchored = true;
+            i++;
+        }
+        for (; i < items.size() && items[i]->kind == Ast::SET && items[i]->set.count() == 1; i++) {
+            for (int c = 0; c < 256; c++) if (items[i]->set.test(c)) prefix += static_cast<char>(c);
+        }
+    }
+
+    //эпсилон-замыкание: добавляет в out состояния SET, END (если конец текста не проверяем) и MATCH
+    void closure(int from, bool atStart, bool atEnd, std::vector<char>& seen, std::vector<int>& out) const {
+        std::vector<int> stack{from};
+        while (!stack.empty()) {
+            int id = stack.back();
+            stack.pop_back();
+            if (id < 0 || seen[id]) continue;
+            seen[id] = 1;
+            const Node& node = nodes[id];
+            switch (node.type) {
+            case Node::SET: case Node::MATCH: out.push_back(id); break;
+            case Node::END: if (atEnd) stack.push_back(node.out); else out.push_back(id); break;
+            case Node::BEGIN: if (atStart) stack.push_back(node.out); break;
+            case Node::EMPTY: stack.push_back(node.out); break;
+            case Node::SPLIT: stack.push_back(node.out2); stack.push_back(node.out); break;
+            }
+        }
+    }
+
+    bool containsMatch(const std::vector<int>& set) const {
+        for (int id : set) if (nodes[id].type == Node::MATCH) return true;
+        return false;
+    }
+
+    //совпадение, если текст кончается здесь: за $ идет MATCH
+    bool acceptsAtEnd(const std::vector<int>& set, bool atStart) const {
+        std::vector<char> seen(nodes.size(), 0);
+        std::vector<int> out;
+        for (int id : set) if (nodes[id].type == Node::END) closure(nodes[id].out, atStart, true, seen, out);
+        return containsMatch(out);
+    }
+
+    //следующее множество НКА после байта c; поиск подстроки - каждый раз заново добавляем start
+    std::vector<int> step(const std::vector<int>& set, unsigned char c) const {
+        std::vector<char> seen(nodes.size(), 0);
+        std::vector<int> out;
+        for (int id : set) if (nodes[id].type == Node::SET && nodes[id].set.test(c)) closure(nodes[id].out, false, false, seen, out);
+        closure(start, false, false, seen, out);
+        std::sort(out.begin(), out.end());
+        return out;
+    }
+
+    //кэш переполнен: новое поколение. Состояния остаются в pool, поэтому читатель со старым указателем не упадет,
+    //а по смене epoch поймет, что прочитанное могло поменяться. Вызывается под mutex
+    void flush() const {
+        //корни чистятся до смены epoch: кто прочитал новый epoch, не уйдет со старого корня в старое состояние
+        for (DfaState* root : {initial.get(), restart.get()}) {
+            for (auto& edge : root->next) edge.store(nullptr, std::memory_order_relaxed);
+        }
+        epoch.fetch_add(1, std::memory_order_release);
+        std::atomic_thread_fence(std::memory_order_release); //новый epoch виден раньше любых записей нового поколения
+        states.clear();
+        flushes++;
+    }
+
+    //находит или создает состояние ДКА, при переполнении сбрасывает кэш. Вызывается под mutex
+    const DfaState* intern(std::vector<int> set) const {
+        if (containsMatch(set)) return matched.get();
+        if (set.empty()) return dead.get();
+        std::string key(reinterpret_cast<const char*>(set.data()), set.size() * sizeof(int));
+        auto found = states.find(key);
+        if (found != states.end()) return found->second;
+        if (states.size() >= MAX_STATES) flush();
+        DfaState* state;
+        if (states.size() < pool.size()) {
+            state = pool[states.size()].get();
+            for (auto& edge : state->next) edge.store(nullptr, std::memory_order_relaxed);
+        } else {
+            pool.emplace_back(new DfaState);
+            state = pool.back().get();
+        }
+        state->acceptAtEnd.store(acceptsAtEnd(set, false), std::memory_order_relaxed);
+        state->nfa = std::move(set);
+        states.emplace(std::move(key), state);
+        return state;
+    }
+
+    //nullptr - пока поток шел по строке, кэш сбросил другой поток, и state уже может быть другим состоянием.
+    //Если сбросил сам этот переход, путь до state прочитан до сброса и верен: seen переходит на новое поколение
+    const DfaState* transition(const DfaState* state, unsigned char c, uint64_t& seen) const {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (epoch.load(std::memory_order_relaxed) != seen) return nullptr;
+        const DfaState* next = state->next[c].load(std::memory_order_acquire);
+        if (next) return next; //уже достроил другой поток
+        next = intern(step(state->nfa, c));
+        if (epoch.load(std::memory_order_relaxed) != seen) seen = epoch.load(std::memory_order_relaxed);
+        else const_cast<DfaState*>(state)->next[c].store(next, std::memory_order_release);
+        return next;
+    }
+
+    //проход по кэшу ДКА: 1 - совпадение, 0 - нет, -1 - кэш сбросили посреди строки
+    int run(const DfaState* state, const unsigned char* p, const unsigned char* end) const {
+        uint64_t seen = epoch.load(std::memory_order_acquire);
+        int found = -1;
+        for (; p != end; ++p) {
+            const DfaState* next = state->next[*p].load(std::memory_order_acquire);
+            if (!next) {
+                next = transition(state, *p, seen);
+                if (!next) return -1;
+            }
+            if (next == matched.get()) {
+                found = 1;
+                break;
+            }
+            if (next == dead.get()) {
+                found = 0;
+                break;
+            }
+            state = next;
+        }
+        if (found < 0) found = state->acceptAtEnd.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire); //как у seqlock: все чтения выше - до проверки epoch
+        return epoch.load(std::memory_order_relaxed) == seen ? found : -1;
+    }
+
+    //кэш сбрасывают быстрее, чем дочитывается строка: дочитываем текст по НКА, как обычный Томпсон
+    bool simulate(std::vector<int> set, const unsigned char* p, const unsigned char* end) const {
+        for (; p != end; ++p) {
+            set = step(set, *p);
+            if (containsMatch(set)) return true;
+            if (set.empty()) return false;
+        }
+        return acceptsAtEnd(set, false);
+    }
+
+    explicit RegexDfa(const std::string& pattern) : pattern(pattern) {
+        Ast ast = parseAlt();
+        if (more()) throw Unsupported(); //лишняя )
+        int match = addNode(Node::MATCH, -1);
+        start = compileAst(ast, match);
+        findPrefix(ast);
+
+        std::vector<char> seen(nodes.size(), 0);
+        std::vector<int> set;
+        closure(start, true, false, seen, set);
+        std::sort(set.begin(), set.end());
+        //начальное состояние не кладем в общую таблицу: при тех же состояниях НКА у него ^ выполняется
+        initial.reset(new DfaState);
+        initial->acceptAtEnd = acceptsAtEnd(set, true);
+        initial->nfa = std::move(set);
+        std::fill(std::begin(seen), std::end(seen), 0);
+        std::vector<int> middle;
+        closure(start, false, false, seen, middle);
+        std::sort(middle.begin(), middle.end());
+        //у обоих корней nfa не меняется, поэтому они живут вне таблицы и переживают сброс
+        restart.reset(new DfaState);
+        restart->acceptAtEnd = acceptsAtEnd(middle, false);
+        restart->nfa = std::move(middle);
+    }
+
+public:
+    //nullptr - в выражении есть то, чего движок не умеет
+    static std::shared_ptr<const RegexDfa> compile(const std::string& pattern) {
+        try {
+            return std::shared_ptr<const RegexDfa>(new RegexDfa(pattern));
+        } catch (const Unsupported&) {
+            return nullptr;
+        }
+    }
+
+    bool search(const std::string& text) const {
+        const unsigned char* p = reinterpret_cast<const unsigned char*>(text.data());
+        const unsigned char* end = p + text.size();
+        const DfaState* state = initial.get();
+        if (containsMatch(state->nfa)) return true; //пустое совпадение в начале
+        if (!prefix.empty()) {
+            if (anchored) {
+                if (text.compare(0, prefix.size(), prefix) != 0) return false;
+            } else {
+                //совпадение может начаться только там, где есть префикс; find - это memchr + memcmp
+                size_t at = text.find(prefix);
+                if (at == std::string::npos) return false;
+                if (at > 0) {
+                    p += at;
+                    state = restart.get();
+                }
+            }
+        }
+        int found = run(state, p, end);
+        if (found < 0) found = run(state, p, end); //кэш сбросили посреди строки - еще раз
+        return found < 0 ? simulate(state->nfa, p, end) : found == 1;
+    }
+
+    size_t stateCount() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return states.size();
+    }
+
+    //сколько раз кэш переполнялся и строился заново
+    size_t flushCount() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return flushes;
+    }
+};
 
 class ReLogFilter: public ILogFilter {
     std::regex pattern;
+    std::shared_ptr<const RegexDfa> dfa; //nullptr - работает std::regex
 public:
     ReLogFilter(const std::regex& pattern): pattern(pattern) {}
 
+    //строка компилируется в ленивый ДКА; если выражение вне подмножества (обратные ссылки, \b, просмотр вперед) - std::regex
+    ReLogFilter(const std::string& pattern): dfa(RegexDfa::compile(pattern)) {
+        if (!dfa) this->pattern = std::regex(pattern);
+    }
+
     bool match(const std::string& text) const override { 
-        return std::regex_search(text, pattern);
+        return dfa ? dfa->search(text) : std::regex_search(text, pattern);
+    }
+
+    bool compiled() const { return dfa != nullptr; }
+};
+
+//записи не ниже уровня; у простой строки уровня нет
+class LevelFilter: public ILogFilter {
+    LogLevel level;
+public:
+    LevelFilter(LogLevel level): level(level) {}
+
+    bool match(const std::string&) const override { return false; }
+    bool matchRecord(const Record& record) const override { return !record.plain && record.level >= level; }
+};
+
+//поле записи равно значению, без форматирования текста
+class FieldFilter: public ILogFilter {
+    Field expected;
+public:
+    FieldFilter(Field expected): expected(std::move(expected)) {}
+
+    bool match(const std::string&) const override { return false; }
+    bool matchRecord(const Record& record) const override {
+        const Field* field = record.field(expected.key);
+        return !record.plain && field && *field == expected;
     }
 };
 
@@ -35,6 +866,12 @@ public:
 class ILogHandler {
 public: 
     virtual void handle(const std::string& text) const = 0;
+    //структурированная запись; по умолчанию форматируется в строку
+    virtual void handleRecord(const Record& record) const { handle(record.formatted()); }
+    //пачка записей; по умолчанию по одной
+    virtual void handleBatch(RecordSpan records) const {
+        for (const Record& record : records) handleRecord(record);
+    }
     virtual ~ILogHandler() = default;
 };
 
@@ -44,80 +881,2039 @@ public:
     void handle(const std::string& text) const override {
         std::cout << "ConsoleHandler: " << text << std::endl; 
     }
-};
 
-class Socket {
-public:
-    void send(const std::string& str) {
-        std::cout << str << std::endl;
+    //вся пачка одним writev; то, что уже выведено через cout, сбрасываем раньше, чтобы не перепутать порядок
+    void handleBatch(RecordSpan records) const override {
+#ifndef _WIN32
+        static const char prefix[] = "ConsoleHandler: ";
+        std::cout.flush();
+        std::fflush(stdout);
+        std::vector<iovec> parts;
+        parts.reserve(records.size() * 3);
+        for (const Record& record : records) {
+            addPart(parts, prefix, sizeof(prefix) - 1);
+            addPart(parts, record.formatted().data(), record.formatted().size());
+            addPart(parts, "\n", 1);
+        }
+        writeAll(STDOUT_FILENO, parts);
+#else
+        ILogHandler::handleBatch(records);
+#endif
     }
 };
 
-class SocketHandler : public ILogHandler {
+//ограниченная очередь без блокировок для нескольких производителей и потребителей (ячейки с номером последовательности).
+//Элемент переносится в ячейку перемещением, без выделения памяти внутри очереди
+template<typename T>
+class LogRingBuffer {
+    struct Cell {
+        std::atomic<size_t> sequence{0};
+        T item;
+    };
+
+    std::unique_ptr<Cell[]> cells;
+    size_t mask;
+    alignas(64) std::atomic<size_t> head{0}; //следующая позиция записи
+    alignas(64) std::atomic<size_t> tail{0}; //следующая позиция чтения
+
 public:
-    void handle(const std::string& text) const override {
-        Socket socket;
-        socket.send("SocketHandler: " + text);
+    explicit LogRingBuffer(size_t capacity) {
+        size_t size = 2;
+        while (size < capacity) size <<= 1; //степень двойки, чтобы позиция в массиве была pos & mask
+        cells.reset(new Cell[size]);
+        mask = size - 1;
+        for (size_t i = 0; i < size; i++) cells[i].sequence.store(i, std::memory_order_relaxed);
     }
-};
 
-class FileHandler : public ILogHandler {
-    std::string path;
-public:
-    FileHandler(const std::string& path): path(path) {}
+    size_t capacity() const { return mask + 1; }
 
-    void handle(const std::string& text) const override {
-        std::ofstream fout;
-        fout.open(path, std::ios_base::app);
-        
-        fout << "FileHandler: " << text << std::endl;
-        fout.close();
+    //false - очередь заполнена, item не тронут
+    bool tryPush(T& item) {
+        size_t pos = head.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = cells[pos & mask];
+            size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.item = std::move(item);
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = head.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool tryPop(T& item) {
+        size_t pos = tail.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = cells[pos & mask];
+            size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0) {
+                if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    item = std::move(cell.item);
+                    cell.sequence.store(pos + mask + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    //до max сообщений за раз, возвращает сколько добавлено в batch
+    size_t popBatch(std::vector<T>& batch, size_t max) {
+        size_t count = 0;
+        T item;
+        while (count < max && tryPop(item)) {
+            batch.push_back(std::move(item));
+            count++;
+        }
+        return count;
     }
 };
 
-class SyslogHandler : public ILogHandler {
-    std::string filename;
-public:
-    SyslogHandler(const std::string& filename = "system_log.txt") : filename(filename) {}
+//что делать производителю, если очередь заполнена
+enum class Overflow { BLOCK, DROP };
 
-    void handle(const std::string& text) const override {
-        std::ofstream syslog;
-        syslog.open(filename, std::ios::app);  // Режим добавления
-        
-        if (syslog.is_open()) {
-            syslog << "SyslogHandler: " << text << std::endl;
+//настройки потока к коллектору
+struct SocketOptions {
+    size_t queueCapacity = 1 << 16;
+    Overflow overflow = Overflow::DROP;               //по умолчанию медленная сеть не тормозит программу
+    size_t batchBytes = 64 * 1024;                    //сколько кадров склеивать в один send
+    std::chrono::milliseconds connectTimeout{1000};
+    std::chrono::milliseconds minBackoff{50};         //пауза перед переподключением, удваивается до maxBackoff
+    std::chrono::milliseconds maxBackoff{5000};
+    std::chrono::milliseconds shutdownTimeout{2000};  //сколько дописывать очередь при уничтожении
+};
+
+#ifndef _WIN32
+//адрес коллектора: "unix:/путь" или "хост:порт" (IPv4, localhost = 127.0.0.1)
+struct Endpoint {
+    sockaddr_storage storage{};
+    socklen_t length = 0;
+
+    int family() const { return storage.ss_family; }
+    const sockaddr* address() const { return reinterpret_cast<const sockaddr*>(&storage); }
+
+    static bool parse(const std::string& text, Endpoint& endpoint) {
+        endpoint = Endpoint();
+        if (text.compare(0, 5, "unix:") == 0) {
+            sockaddr_un* unixAddress = reinterpret_cast<sockaddr_un*>(&endpoint.storage);
+            std::string path = text.substr(5);
+            if (path.empty() || path.size() >= sizeof(unixAddress->sun_path)) return false;
+            unixAddress->sun_family = AF_UNIX;
+            std::memcpy(unixAddress->sun_path, path.c_str(), path.size() + 1);
+            endpoint.length = sizeof(sockaddr_un);
+            return true;
         }
-        syslog.close();
+        size_t colon = text.rfind(':');
+        if (colon == std::string::npos) return false;
+        std::string host = text.substr(0, colon);
+        if (host == "localhost") host = "127.0.0.1";
+        sockaddr_in* inetAddress = reinterpret_cast<sockaddr_in*>(&endpoint.storage);
+        inetAddress->sin_family = AF_INET;
+        inetAddress->sin_port = htons(static_cast<uint16_t>(std::atoi(text.c_str() + colon + 1)));
+        if (inet_pton(AF_INET, host.c_str(), &inetAddress->sin_addr) != 1) return false;
+        endpoint.length = sizeof(sockaddr_in);
+        return true;
     }
 };
 
-//принимает списки фильтров и списки обработчиков
-class Logger {
-    std::vector<ILogFilter*> filters;  
-    std::vector<ILogHandler*> handlers;
+inline bool setNonBlocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
 
-public:
-    Logger(std::vector<ILogFilter*> filters, std::vector<ILogHandler*> handlers): filters(filters), handlers(handlers) { }
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0 //macOS: SIGPIPE отключается через SO_NOSIGPIPE
+#endif
+#endif
 
-    void log(const std::string& text) {
+//без адреса - печать в консоль, как раньше. С адресом - поток к коллектору: send кладет строку в ограниченную очередь,
+//фоновый поток склеивает кадры "<длина> <сообщение>" (RFC 6587) и пишет неблокирующим сокетом.
+//Соединение потеряно - переподключается с растущей паузой; недописанная пачка после этого уходит заново целиком
+class Socket {
+    std::string target;
+    SocketOptions options;
+    std::unique_ptr<LogRingBuffer<std::string>> queue; //nullptr - печать в консоль
+
+    std::thread sender;
+    std::atomic<bool> stopping{false};
+    std::atomic<int> idle{0};
+    std::mutex idleMutex;
+    std::condition_variable wakeup;
+
+    std::atomic<size_t> queued{0}, sent{0}, dropped{0}, reconnects{0};
+    std::atomic<bool> connected{false};
+
+#ifndef _WIN32
+    Endpoint endpoint;
+    int fd = -1;
+    bool everConnected = false;
+
+    void disconnect() {
+        if (fd >= 0) ::close(fd);
+        fd = -1;
+        connected.store(false);
+    }
+
+    bool connect() {
+        fd = ::socket(endpoint.family(), SOCK_STREAM, 0);
+        if (fd < 0) return false;
+        setNonBlocking(fd);
+        if (endpoint.family() == AF_INET) {
+            int on = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on)); //пачки собираем сами
+        }
+#ifdef SO_NOSIGPIPE
+        int on = 1;
+        setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+        if (::connect(fd, endpoint.address(), endpoint.length) != 0) {
+            if (errno != EINPROGRESS) {
+                disconnect();
+                return false;
+            }
+            pollfd waiting{fd, POLLOUT, 0};
+            int error = 0;
+            socklen_t length = sizeof(error);
+            if (poll(&waiting, 1, static_cast<int>(options.connectTimeout.count())) != 1
+                || getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &length) != 0 || error != 0) {
+                disconnect();
+                return false;
+            }
+        }
+        if (everConnected) reconnects.fetch_add(1);
+        everConnected = true;
+        connected.store(true);
+        return true;
+    }
+
+    //ждет на wakeup до timeout или пока не разбудят
+    void pause(std::chrono::milliseconds timeout) {
+        idle.fetch_add(1);
+        {
+            std::unique_lock<std::mutex> lock(idleMutex);
+            if (!stopping.load()) wakeup.wait_for(lock, timeout);
+        }
+        idle.fetch_sub(1);
+    }
 
-        //если хотя бы один фильтр нужно логировать, то логируем по всем обработчикам 
-        for (ILogFilter* filter : filters) {
-            if (filter->match(text)) {
-                for (ILogHandler* handler : handlers) {
-                    handler->handle(text);
+    //пауза перед переподключением до until: новые сообщения ее не прерывают (иначе каждое send давало бы connect),
+    //прерывает только начало остановки
+    void backoffPause(std::chrono::steady_clock::time_point until) {
+        std::unique_lock<std::mutex> lock(idleMutex);
+        const bool wasStopping = stopping.load();
+        wakeup.wait_until(lock, until, [&] { return stopping.load() != wasStopping; });
+    }
+
+    void run() {
+        std::string batch;       //склеенные кадры
+        size_t offset = 0;       //сколько из batch уже отдано ядру
+        size_t frames = 0;
+        std::string item;
+        std::chrono::milliseconds backoff = options.minBackoff;
+        std::chrono::steady_clock::time_point deadline{};
+        auto expired = [&] {
+            if (!stopping.load()) return false;
+            if (deadline == std::chrono::steady_clock::time_point{}) deadline = std::chrono::steady_clock::now() + options.shutdownTimeout;
+            return std::chrono::steady_clock::now() >= deadline;
+        };
+
+        for (;;) {
+            if (offset == batch.size()) {
+                batch.clear();
+                offset = 0;
+                frames = 0;
+                while (batch.size() < options.batchBytes && queue->tryPop(item)) {
+                    batch += std::to_string(item.size());
+                    batch += ' ';
+                    batch += item;
+                    frames++;
                 }
-                return;
+                if (batch.empty()) {
+                    if (stopping.load()) break; //все дописано
+                    pause(std::chrono::milliseconds(1));
+                    continue;
+                }
+            }
+            if (fd < 0) {
+                if (expired()) break;
+                if (!connect()) {
+                    auto until = std::chrono::steady_clock::now() + backoff;
+                    if (stopping.load()) until = std::min(until, deadline); //при остановке - не дольше shutdownTimeout
+                    backoffPause(until);
+                    backoff = std::min(backoff * 2, options.maxBackoff);
+                    continue;
+                }
+                backoff = options.minBackoff;
+            }
+            ssize_t written = ::send(fd, batch.data() + offset, batch.size() - offset, MSG_NOSIGNAL);
+            if (written > 0) {
+                offset += static_cast<size_t>(written);
+                io_stats::writes.fetch_add(1, std::memory_order_relaxed);
+                if (offset == batch.size()) sent.fetch_add(frames);
+                continue;
             }
+            if (written < 0 && errno == EINTR) continue;
+            if (written < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                //коллектор не успевает читать: ждем места в буфере сокета
+                if (expired()) break;
+                pollfd waiting{fd, POLLOUT, 0};
+                poll(&waiting, 1, 100);
+                continue;
+            }
+            disconnect();
+            offset = 0;
         }
 
+        //не успели за shutdownTimeout - остаток считаем потерянным
+        if (offset != batch.size()) dropped.fetch_add(frames);
+        while (queue->tryPop(item)) dropped.fetch_add(1);
+        disconnect();
+    }
+#endif
+
+public:
+    Socket() = default;
+
+    Socket(const std::string& address, const SocketOptions& options = SocketOptions()): target(address), options(options) {
+#ifndef _WIN32
+        if (!Endpoint::parse(address, endpoint)) throw std::invalid_argument("bad collector address: " + address);
+        queue.reset(new LogRingBuffer<std::string>(options.queueCapacity));
+        sender = std::thread([this] { run(); });
+#endif
+    }
 
+    ~Socket() {
+        if (!queue) return;
+        {
+            std::lock_guard<std::mutex> lock(idleMutex); //иначе notify может прийти между проверкой stopping и wait
+            stopping.store(true);
+        }
+        wakeup.notify_all();
+        sender.join();
     }
-};
 
-int main() {
+    Socket(const Socket&) = delete;
+    Socket& operator=(const Socket&) = delete;
+
+    void send(std::string str) {
+        if (!queue) {
+            std::cout << str << std::endl;
+            return;
+        }
+        for (int attempt = 0; !queue->tryPush(str); attempt++) {
+            if (options.overflow == Overflow::DROP) {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            if (idle.load() > 0) wakeup.notify_one();
+            //BLOCK: ждем, пока поток отправки освободит место; сначала несколько yield, потом короткий сон
+            if (attempt < 16) std::this_thread::yield();
+            else std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+        queued.fetch_add(1, std::memory_order_relaxed);
+        if (idle.load() > 0) wakeup.notify_one();
+    }
+
+    //ждет, пока все принятое в очередь будет отдано ядру; false - не успели за timeout
+    bool drain(std::chrono::milliseconds timeout) {
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+        while (sent.load() < queued.load()) {
+            if (std::chrono::steady_clock::now() >= deadline) return false;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return true;
+    }
+
+    const std::string& address() const { return target; }
+    size_t sentCount() const { return sent.load(); }
+    size_t droppedCount() const { return dropped.load(); }
+    size_t reconnectCount() const { return reconnects.load(); }
+    bool isConnected() const { return connected.load(); }
+};
+
+class SocketHandler : public ILogHandler {
+    mutable Socket socket;
+public:
+    SocketHandler() = default;
+    SocketHandler(const std::string& address, const SocketOptions& options = SocketOptions()): socket(address, options) {}
+
+    void handle(const std::string& text) const override {
+        socket.send("SocketHandler: " + text);
+    }
+
+    bool drain(std::chrono::milliseconds timeout = std::chrono::milliseconds(2000)) const { return socket.drain(timeout); }
+    const Socket& connection() const { return socket; }
+};
+
+#ifndef _WIN32
+//замена настоящему коллектору для проверок и замеров: принимает соединения и разбирает кадры "<длина> <сообщение>"
+class LogCollector {
+    int listener = -1;
+    std::string boundAddress;
+    std::string unixPath;
+    std::function<void(const std::string&)> onMessage;
+    std::atomic<bool> stopping{false};
+    std::atomic<size_t> received{0};
+    std::atomic<int> readDelayMicros{0};
+    std::thread thread;
+
+    struct Client {
+        int fd;
+        std::string buffer;
+    };
+
+    //целые кадры из начала буфера; остаток ждет следующего чтения
+    void parse(std::string& buffer) {
+        size_t pos = 0;
+        for (;;) {
+            size_t space = buffer.find(' ', pos);
+            if (space == std::string::npos) break;
+            size_t length = std::strtoul(buffer.c_str() + pos, nullptr, 10);
+            if (buffer.size() - space - 1 < length) break;
+            std::string message = buffer.substr(space + 1, length);
+            if (onMessage) onMessage(message);
+            received.fetch_add(1);
+            pos = space + 1 + length;
+        }
+        buffer.erase(0, pos);
+    }
+
+    void run() {
+        std::vector<Client> clients;
+        std::vector<pollfd> waiting;
+        char chunk[64 * 1024];
+        while (!stopping.load()) {
+            waiting.assign(1, pollfd{listener, POLLIN, 0});
+            for (const Client& client : clients) waiting.push_back(pollfd{client.fd, POLLIN, 0});
+            if (poll(waiting.data(), waiting.size(), 50) <= 0) continue;
+            if (waiting[0].revents & POLLIN) {
+                int fd = ::accept(listener, nullptr, nullptr);
+                if (fd >= 0) clients.push_back(Client{fd, std::string()});
+            }
+            for (size_t i = 1; i < waiting.size(); i++) {
+                if (!(waiting[i].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+                Client& client = clients[i - 1];
+                if (int delay = readDelayMicros.load()) std::this_thread::sleep_for(std::chrono::microseconds(delay));
+                ssize_t length = ::recv(client.fd, chunk, sizeof(chunk), 0);
+                if (length > 0) {
+                    client.buffer.append(chunk, static_cast<size_t>(length));
+                    parse(client.buffer);
+                } else if (length == 0 || (errno != EAGAIN && errno != EINTR)) {
+                    ::close(client.fd);
+                    client.fd = -1;
+                }
+            }
+            clients.erase(std::remove_if(clients.begin(), clients.end(), [](const Client& client) { return client.fd < 0; }), clients.end());
+        }
+        for (const Client& client : clients) ::close(client.fd);
+    }
+
+public:
+    //"unix:/путь" или "хост:порт"; порт 0 - любой свободный, настоящий адрес вернет address()
+    LogCollector(const std::string& address, std::function<void(const std::string&)> onMessage = nullptr): onMessage(std::move(onMessage)) {
+        Endpoint endpoint;
+        if (!Endpoint::parse(address, endpoint)) throw std::invalid_argument("bad collector address: " + address);
+        listener = ::socket(endpoint.family(), SOCK_STREAM, 0);
+        if (endpoint.family() == AF_UNIX) {
+            unixPath = address.substr(5);
+            ::unlink(unixPath.c_str());
+        } else {
+            int on = 1;
+            setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+        }
+        if (listener < 0 || ::bind(listener, endpoint.address(), endpoint.length) != 0 || ::listen(listener, 64) != 0) {
+            if (listener >= 0) ::close(listener);
+            throw std::runtime_error("collector cannot listen on " + address);
+        }
+        boundAddress = address;
+        if (endpoint.family() == AF_INET) {
+            sockaddr_in bound{};
+            socklen_t length = sizeof(bound);
+            getsockname(listener, reinterpret_cast<sockaddr*>(&bound), &length);
+            boundAddress = address.substr(0, address.rfind(':') + 1) + std::to_string(ntohs(bound.sin_port));
+        }
+        thread = std::thread([this] { run(); });
+    }
+
+    ~LogCollector() {
+        stop();
+        ::close(listener);
+        if (!unixPath.empty()) ::unlink(unixPath.c_str());
+    }
+
+    LogCollector(const LogCollector&) = delete;
+    LogCollector& operator=(const LogCollector&) = delete;
+
+    //перестает принимать и читать; после возврата onMessage больше не вызывается
+    void stop() {
+        stopping.store(true);
+        if (thread.joinable()) thread.join();
+    }
+
+    const std::string& address() const { return boundAddress; }
+    size_t receivedCount() const { return received.load(); }
+    //медленный коллектор: пауза перед каждым чтением
+    void setReadDelay(std::chrono::microseconds delay) { readDelayMicros.store(static_cast<int>(delay.count())); }
+};
+#endif
+
+//когда сбрасывать буфер в файл
+struct FlushPolicy {
+    size_t bufferSize = 64 * 1024;                       //сброс, когда буфер заполнен
+    std::chrono::milliseconds interval{1000};            //и не реже этого интервала (0 - только по размеру)
+    const ILogFilter* immediate = nullptr;               //сообщения, подходящие под фильтр, пишутся сразу (например, ошибки)
+};
+
+//ротация: когда начинать новый файл и сколько старых хранить
+struct RotationPolicy {
+    enum class Naming { NUMBERED, DATED };
+
+    size_t maxBytes = 0;                 //по размеру (0 - нет)
+    std::chrono::seconds interval{0};    //по времени от границы интервала UTC: 86400 - в полночь (0 - нет)
+    Naming naming = Naming::NUMBERED;    //app.log.1, app.log.2 ... или app.log.20240501-120000
+    size_t keep = 5;                     //сколько старых файлов хранить
+    bool compress = true;                //сжимать старые файлы в .gz в фоновом потоке
+
+    bool enabled() const { return maxBytes > 0 || interval.count() > 0; }
+};
+
+//gzip без внешних библиотек: LZ77 (окно 32 КиБ, хэш-цепочки) и фиксированные коды Хаффмана из RFC 1951.
+//Сжимает хуже zlib, но журналы с повторяющимися строками - в несколько раз.
+//Буферы живут между файлами: повторное сжатие не просит у системы новую память
+class Gzip {
+    static const size_t WINDOW = 32768;
+    static const int HASH_BITS = 15;
+
+    std::vector<int64_t> head, previous;
+    std::string input, output;
+
+    struct BitWriter {
+        std::string& out;
+        uint64_t bits = 0;
+        int count = 0;
+
+        //младшими битами вперед, как требует deflate
+        void put(uint32_t value, int length) {
+            bits |= static_cast<uint64_t>(value) << count;
+            count += length;
+            while (count >= 8) {
+                out += static_cast<char>(bits & 0xFF);
+                bits >>= 8;
+                count -= 8;
+            }
+        }
+
+        void finish() {
+            if (count > 0) out += static_cast<char>(bits & 0xFF);
+            bits = 0;
+            count = 0;
+        }
+    };
+
+    static const uint32_t* crcTable() {
+        static const std::vector<uint32_t> table = [] {
+            std::vector<uint32_t> values(256);
+            for (uint32_t i = 0; i < 256; i++) {
+                uint32_t crc = i;
+                for (int bit = 0; bit < 8; bit++) crc = crc & 1 ? 0xEDB88320u ^ (crc >> 1) : crc >> 1;
+                values[i] = crc;
+            }
+            return values;
+        }();
+        return table.data();
+    }
+
+    static uint32_t crc32(const std::string& data) {
+        const uint32_t* table = crcTable();
+        uint32_t crc = 0xFFFFFFFFu;
+        for (unsigned char c : data) crc = table[(crc ^ c) & 0xFF] ^ (crc >> 8);
+        return crc ^ 0xFFFFFFFFu;
+    }
+
+    //коды Хаффмана пишутся старшим битом вперед - разворачиваем
+    static uint32_t reverse(uint32_t code, int length) {
+        uint32_t result = 0;
+        for (int i = 0; i < length; i++) result |= ((code >> i) & 1) << (length - 1 - i);
+        return result;
+    }
+
+    static void putSymbol(BitWriter& writer, int symbol) {
+        if (symbol <= 143) writer.put(reverse(0x30 + symbol, 8), 8);
+        else if (symbol <= 255) writer.put(reverse(0x190 + symbol - 144, 9), 9);
+        else if (symbol <= 279) writer.put(reverse(symbol - 256, 7), 7);
+        else writer.put(reverse(0xC0 + symbol - 280, 8), 8);
+    }
+
+    static void putMatch(BitWriter& writer, int length, int distance) {
+        static const int lengthBase[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+        static const int lengthExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+        static const int distanceBase[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537,
+                                             2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+        static const int distanceExtra[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+        int code = 28;
+        while (lengthBase[code] > length) code--;
+        putSymbol(writer, 257 + code);
+        writer.put(length - lengthBase[code], lengthExtra[code]);
+        code = 29;
+        while (distanceBase[code] > distance) code--;
+        writer.put(reverse(code, 5), 5);
+        writer.put(distance - distanceBase[code], distanceExtra[code]);
+    }
+
+    //один блок с фиксированными кодами; жадный поиск самого длинного совпадения по 32 кандидатам
+    void deflate(const std::string& data, std::string& out) {
+        const size_t MIN_MATCH = 3, MAX_MATCH = 258;
+        const int MAX_CHAIN = 32;
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data.data());
+        size_t size = data.size();
+        head.assign(size_t(1) << HASH_BITS, -1);
+        previous.assign(WINDOW, -1);
+        auto hash = [&](size_t i) {
+            uint32_t key = bytes[i] | (bytes[i + 1] << 8) | (bytes[i + 2] << 16);
+            return (key * 2654435761u) >> (32 - HASH_BITS);
+        };
+        auto insert = [&](size_t i) {
+            uint32_t h = hash(i);
+            previous[i & (WINDOW - 1)] = head[h];
+            head[h] = static_cast<int64_t>(i);
+        };
+
+        BitWriter writer{out};
+        writer.put(1, 1); //последний блок
+        writer.put(1, 2); //фиксированные коды
+        size_t pos = 0;
+        while (pos < size) {
+            size_t bestLength = 0, bestDistance = 0;
+            if (pos + MIN_MATCH <= size) {
+                size_t limit = std::min(MAX_MATCH, size - pos);
+                int64_t candidate = head[hash(pos)];
+                for (int chain = 0; chain < MAX_CHAIN && candidate >= 0 && pos - candidate <= WINDOW; chain++) {
+                    const unsigned char* a = bytes + candidate;
+                    const unsigned char* b = bytes + pos;
+                    if (a[bestLength] == b[bestLength]) {
+                        size_t length = 0;
+                        while (length < limit && a[length] == b[length]) length++;
+                        if (length > bestLength) {
+                            bestLength = length;
+                            bestDistance = pos - candidate;
+                            if (length == limit) break;
+                        }
+                    }
+                    int64_t next = previous[candidate & (WINDOW - 1)];
+                    if (next >= candidate) break; //ячейку уже занял более новый индекс
+                    candidate = next;
+                }
+                insert(pos);
+            }
+            if (bestLength >= MIN_MATCH) {
+                putMatch(writer, static_cast<int>(bestLength), static_cast<int>(bestDistance));
+                for (size_t i = pos + 1; i < pos + bestLength && i + MIN_MATCH <= size; i++) insert(i);
+                pos += bestLength;
+            } else {
+                putSymbol(writer, bytes[pos]);
+                pos++;
+            }
+        }
+        putSymbol(writer, 256); //конец блока
+        writer.finish();
+    }
+
+    static void putLittleEndian(std::string& out, uint32_t value) {
+        for (int i = 0; i < 4; i++) out += static_cast<char>((value >> (8 * i)) & 0xFF);
+    }
+
+public:
+    //expectedSize - типичный размер файла, память под него берется сразу
+    explicit Gzip(size_t expectedSize = 0) {
+        head.reserve(size_t(1) << HASH_BITS);
+        previous.reserve(WINDOW);
+        input.reserve(expectedSize);
+        output.reserve(expectedSize / 2);
+    }
+
+    void compress(const std::string& data, std::string& out) {
+        out.assign("\x1f\x8b\x08\x00\x00\x00\x00\x00\x00\xff", 10); //заголовок: deflate, без имени и времени
+        deflate(data, out);
+        putLittleEndian(out, crc32(data));
+        putLittleEndian(out, static_cast<uint32_t>(data.size()));
+    }
+
+    //to пишется через временный файл и переименование - недописанный архив никто не увидит
+    bool compressFile(const std::string& from, const std::string& to) {
+        std::FILE* in = std::fopen(from.c_str(), "rb");
+        if (!in) return false;
+        input.clear();
+        char chunk[65536];
+        for (size_t n; (n = std::fread(chunk, 1, sizeof(chunk), in)) > 0;) input.append(chunk, n);
+        std::fclose(in);
+        compress(input, output);
+        std::string temporary = to + ".tmp";
+        std::FILE* out = std::fopen(temporary.c_str(), "wb");
+        if (!out) return false;
+        bool written = std::fwrite(output.data(), 1, output.size(), out) == output.size();
+        written = std::fclose(out) == 0 && written;
+        if (!written) return false;
+        std::error_code error;
+        std::filesystem::last_write_time(temporary, std::filesystem::last_write_time(from, error), error);
+        std::filesystem::rename(temporary, to, error);
+        return !error;
+    }
+};
+
+inline bool endsWith(const std::string& text, const std::string& suffix) {
+    return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+//файл, открытый на все время работы, с буфером в памяти: одна запись write на много сообщений
+//вместо open/write/close на каждое. Файл переоткрывается по SIGHUP и если его переименовали (ротация).
+//Своя ротация (RotationPolicy): под тем же mutex, что и запись, файл переименовывается, сразу открывается новый
+//и удаляются лишние старые файлы; сжатие делает отдельный поток - запись его не ждет
+class BufferedFile {
+    std::string path;
+    FlushPolicy policy;
+    RotationPolicy rotation;
+    std::FILE* file = nullptr;
+    std::string buffer;
+    std::mutex mutex;
+    unsigned reopenSeen = 0;
+    std::chrono::steady_clock::time_point lastCheck;
+
+    size_t fileBytes = 0;                              //сколько уже в текущем файле на диске
+    std::chrono::system_clock::time_point nextRotation;
+    unsigned sequence = 0;                             //номер последнего старого файла (NUMBERED)
+    std::chrono::steady_clock::time_point rotationRetry; //rename не удался - следующая попытка не раньше
+    std::deque<std::string> rotatedNames;              //старые файлы (имя без .gz) от старых к новым
+    std::vector<std::string> expired;                  //лишние старые файлы: удалит flusher вне mutex
+    static constexpr size_t EXPIRED_BATCH = 4;
+    std::atomic<size_t> rotations{0};
+    std::atomic<size_t> lost{0};                       //байт, которые не удалось записать (файл не открылся, ошибка записи)
+
+    std::thread flusher;
+    std::condition_variable flusherWakeup;
+    bool stopping = false;
+
+    std::thread archiver;                              //сжимает старые файлы
+    std::unique_ptr<Gzip> gzip;                        //только для archiver
+    mutable std::mutex archiveMutex;
+    std::condition_variable archiveWakeup;
+    std::deque<std::string> archiveQueue;
+    std::string compressing;                           //файл, который archiver сжимает сейчас
+    bool compressingRemoved = false;                   //его уже удалила ротация - архив не нужен
+    bool archiveStopping = false;
+    std::atomic<size_t> archived{0};
+    std::atomic<uint64_t> archiveNanos{0};
+
+    static std::atomic<unsigned> reopenRequests; //увеличивается обработчиком SIGHUP
+
+    void open() {
+        file = std::fopen(path.c_str(), "ab");
+        fileBytes = 0;
+        if (file) {
+            std::setvbuf(file, nullptr, _IONBF, 0); //буферизуем сами, stdio не нужен
+            std::fseek(file, 0, SEEK_END);
+            long size = std::ftell(file);
+            fileBytes = size > 0 ? static_cast<size_t>(size) : 0;
+        }
+        lastCheck = std::chrono::steady_clock::now();
+        if (rotation.interval.count() > 0) {
+            //следующая граница интервала, например ближайшая полночь UTC
+            auto now = std::chrono::time_point_cast<std::chrono::seconds>(std::chrono::system_clock::now());
+            auto sinceEpoch = now.time_since_epoch();
+            nextRotation = now - sinceEpoch % rotation.interval + rotation.interval;
+        }
+    }
+
+    std::string fileName() const { return std::filesystem::path(path).filename().string(); }
+
+    //старые файлы этого журнала: "имя.<цифры...>" с .gz или без
+    std::vector<std::filesystem::path> rotatedFiles() const {
+        std::vector<std::filesystem::path> files;
+        std::filesystem::path directory = std::filesystem::path(path).parent_path();
+        if (directory.empty()) directory = ".";
+        std::string prefix = fileName() + ".";
+        std::error_code error;
+        for (const auto& entry : std::filesystem::directory_iterator(directory, error)) {
+            std::string name = entry.path().filename().string();
+            if (name.size() > prefix.size() && name.compare(0, prefix.size(), prefix) == 0
+                && std::isdigit(static_cast<unsigned char>(name[prefix.size()])) && !endsWith(name, ".tmp")) {
+                files.push_back(entry.path());
+            }
+        }
+        return files;
+    }
+
+    std::string rotatedName() {
+        std::error_code error;
+        auto taken = [&](const std::string& name) {
+            return std::filesystem::exists(name, error) || std::filesystem::exists(name + ".gz", error);
+        };
+        if (rotation.naming == RotationPolicy::Naming::NUMBERED) {
+            std::string name;
+            do name = path + "." + std::to_string(++sequence); while (taken(name));
+            return name;
+        }
+        //"2024-05-01 12:00:00.123" -> "20240501-120000"
+        std::string stamp = Record::formatTime(std::chrono::system_clock::now());
+        std::string name = path + "." + stamp.substr(0, 4) + stamp.substr(5, 2) + stamp.substr(8, 2) + "-"
+                           + stamp.substr(11, 2) + stamp.substr(14, 2) + stamp.substr(17, 2);
+        std::string candidate = name;
+        for (int n = 1; taken(candidate); n++) candidate = name + "." + std::to_string(n);
+        return candidate;
+    }
+
+    void rotateIfNeeded() {
+        if (!rotation.enabled() || fileBytes == 0) return;
+        bool due = (rotation.maxBytes > 0 && fileBytes >= rotation.maxBytes)
+                   || (rotation.interval.count() > 0 && std::chrono::system_clock::now() >= nextRotation);
+        if (due && std::chrono::steady_clock::now() >= rotationRetry) rotateLocked();
+    }
+
+    //переименование атомарно, новый файл открывается до того, как mutex отпустят, - писатели видят либо старый, либо новый
+    void rotateLocked() {
+        flushLocked();
+        close();
+        unsigned previousSequence = sequence;
+        std::string target = rotatedName();
+        std::error_code error;
+        std::filesystem::rename(path, target, error);
+        open();
+        if (error) {
+            //файл остался на месте и по-прежнему велик: номер не тратим и пробуем снова не раньше чем через секунду,
+            //иначе каждая запись повторяла бы flush/close/rename/open
+            sequence = previousSequence;
+            rotationRetry = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+            return;
+        }
+        rotations.fetch_add(1, std::memory_order_relaxed);
+        rotatedNames.push_back(target);
+        if (rotation.compress) {
+            {
+                std::lock_guard<std::mutex> lock(archiveMutex);
+                archiveQueue.push_back(target);
+            }
+            archiveWakeup.notify_one();
+        }
+        removeOldFiles();
+    }
+
+    //оставляет rotation.keep самых новых старых файлов. Какие удалить, решается сразу при ротации, а не в потоке
+    //сжатия: на загруженной машине он может долго не получать процессор, а диск заполнялся бы.
+    //Сами файлы удаляет flusher (обычный приоритет) на следующем срабатывании, вне mutex, - unlink большого файла
+    //(сотни мкс) не ложится на вызов, который сделал ротацию. Если ротации частые, flusher будится сразу,
+    //как только ждущих удаления файлов набралось EXPIRED_BATCH
+    void removeOldFiles() {
+        while (rotatedNames.size() > rotation.keep) {
+            std::string name = rotatedNames.front();
+            rotatedNames.pop_front();
+            {
+                std::lock_guard<std::mutex> lock(archiveMutex);
+                archiveQueue.erase(std::remove(archiveQueue.begin(), archiveQueue.end(), name), archiveQueue.end());
+                if (name == compressing) compressingRemoved = true;
+            }
+            expired.push_back(name);
+        }
+        if (policy.interval.count() == 0) removeExpired(expired); //flusher нет
+        else if (expired.size() >= EXPIRED_BATCH) flusherWakeup.notify_one();
+    }
+
+    //архив сжимаемого сейчас файла archiver удалит сам (compressingRemoved)
+    static void removeExpired(std::vector<std::string>& names) {
+        for (const std::string& name : names) {
+            std::remove(name.c_str());
+            std::remove((name + ".gz").c_str());
+        }
+        names.clear();
+    }
+
+    void archive() {
+#ifdef __linux__
+        //сжатие - фоновая работа: SCHED_BATCH при пробуждении не вытесняет поток, который пишет журнал, и nice 19.
+        //Не SCHED_IDLE: такой поток на занятой машине может не получить процессор совсем
+        sched_param batch{};
+        pthread_setschedparam(pthread_self(), SCHED_BATCH, &batch);
+        setpriority(PRIO_PROCESS, static_cast<id_t>(::syscall(SYS_gettid)), 19); //в Linux nice у каждого потока свой
+#endif
+        //память под сжатие берем сейчас, а не посреди потока записей: mmap из потока с низким приоритетом
+        //держит блокировку адресного пространства, и пишущий поток ждал бы на ней
+        gzip.reset(new Gzip(rotation.maxBytes + policy.bufferSize));
+        std::unique_lock<std::mutex> lock(archiveMutex);
+        for (;;) {
+            archiveWakeup.wait(lock, [this] { return archiveStopping || !archiveQueue.empty(); });
+            if (archiveStopping) return; //остальное сожмется после перезапуска: конструктор ставит несжатые файлы в очередь
+            std::string name = archiveQueue.front();
+            archiveQueue.pop_front();
+            compressing = name;
+            compressingRemoved = false;
+            lock.unlock();
+            auto start = std::chrono::steady_clock::now();
+            bool packed = gzip->compressFile(name, name + ".gz");
+            auto nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+            lock.lock();
+            if (compressingRemoved) {
+                std::remove((name + ".gz").c_str()); //ротация удалила файл, пока он сжимался
+            } else if (packed) {
+                std::remove(name.c_str());
+                archiveNanos.fetch_add(nanos);
+                archived.fetch_add(1);
+            }
+            compressing.clear();
+        }
+    }
+
+    //"<цифры>" или "<цифры>.gz" после "имя." - номер NUMBERED; даты (20240501-120000) и прочее - нет
+    static bool parseNumber(const std::string& suffix, unsigned& number) {
+        size_t digits = 0;
+        while (digits < suffix.size() && std::isdigit(static_cast<unsigned char>(suffix[digits]))) digits++;
+        if (digits == 0 || digits > 9 || (digits != suffix.size() && suffix.compare(digits, std::string::npos, ".gz") != 0)) return false;
+        number = static_cast<unsigned>(std::stoul(suffix.substr(0, digits)));
+        return true;
+    }
+
+    //старые файлы, оставшиеся с прошлого запуска: продолжаем нумерацию, лишние удаляем, несжатые ставим в очередь
+    void scanRotated() {
+        struct Found {
+            std::filesystem::file_time_type time;
+            bool plain = false;
+            bool packed = false;
+        };
+        std::unordered_map<std::string, Found> found;
+        for (const auto& file : rotatedFiles()) {
+            std::string suffix = file.filename().string().substr(fileName().size() + 1);
+            unsigned number;
+            if (parseNumber(suffix, number)) sequence = std::max(sequence, number);
+            bool packed = endsWith(suffix, ".gz");
+            Found& entry = found[path + "." + (packed ? suffix.substr(0, suffix.size() - 3) : suffix)];
+            std::error_code error;
+            entry.time = std::max(entry.time, std::filesystem::last_write_time(file, error));
+            (packed ? entry.packed : entry.plain) = true;
+        }
+        std::vector<std::pair<std::filesystem::file_time_type, std::string>> byTime;
+        for (const auto& [name, entry] : found) byTime.emplace_back(entry.time, name);
+        std::sort(byTime.begin(), byTime.end());
+        for (const auto& [time, name] : byTime) rotatedNames.push_back(name);
+        removeOldFiles();
+        if (!rotation.compress) return;
+        for (const std::string& name : rotatedNames) {
+            if (found[name].plain && !found[name].packed) archiveQueue.push_back(name);
+        }
+    }
+
+    void close() {
+        if (file) std::fclose(file);
+        file = nullptr;
+    }
+
+    //файл удалили или переименовали - значит, его забрала ротация, начинаем новый
+    bool rotated() const {
+#ifndef _WIN32
+        struct stat onDisk, opened;
+        if (!file || fstat(fileno(file), &opened) != 0) return true;
+        return stat(path.c_str(), &onDisk) != 0 || onDisk.st_ino != opened.st_ino || onDisk.st_dev != opened.st_dev;
+#else
+        return file == nullptr;
+#endif
+    }
+
+    //то, что не записалось, не держим в буфере (он рос бы без предела, пока диск недоступен), а учитываем в lost
+    void flushLocked() {
+        if (buffer.empty()) return;
+        if (!file) open();
+        size_t written = 0;
+        if (file) {
+            written = std::fwrite(buffer.data(), 1, buffer.size(), file);
+            io_stats::writes.fetch_add(1, std::memory_order_relaxed);
+            fileBytes += written;
+        }
+        if (written < buffer.size()) lost.fetch_add(buffer.size() - written, std::memory_order_relaxed);
+        buffer.clear();
+    }
+
+    void reopenIfNeeded() {
+        unsigned requests = reopenRequests.load(std::memory_order_relaxed);
+        bool reopen = requests != reopenSeen;
+        //проверка ротации - не чаще раза в секунду, это два системных вызова
+        auto now = std::chrono::steady_clock::now();
+        if (!reopen && now - lastCheck >= std::chrono::seconds(1)) {
+            lastCheck = now;
+            reopen = rotated();
+        }
+        if (reopen) {
+            reopenSeen = requests;
+            flushLocked(); //то, что накоплено, дописываем в старый файл
+            close();
+            open();
+        }
+    }
+
+    void flushPeriodically() {
+#ifdef __linux__
+        //SCHED_BATCH: при пробуждении не вытесняет пишущий поток, но, в отличие от archiver, nice обычный - процессор получит
+        sched_param batch{};
+        pthread_setschedparam(pthread_self(), SCHED_BATCH, &batch);
+#endif
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!stopping) {
+            if (expired.empty()) flusherWakeup.wait_for(lock, policy.interval);
+            if (!expired.empty()) {
+                std::vector<std::string> names;
+                names.swap(expired);
+                lock.unlock();
+                removeExpired(names);
+                lock.lock();
+            }
+            reopenIfNeeded();
+            flushLocked();
+            rotateIfNeeded();
+        }
+    }
+
+public:
+    BufferedFile(const std::string& path, const FlushPolicy& policy = FlushPolicy(), const RotationPolicy& rotation = RotationPolicy())
+        : path(path), policy(policy), rotation(rotation) {
+        reopenSeen = reopenRequests.load();
+        buffer.reserve(policy.bufferSize);
+        if (rotation.enabled()) {
+            scanRotated();
+            if (rotation.compress) archiver = std::thread([this] { archive(); });
+        }
+        open();
+        if (policy.interval.count() > 0) flusher = std::thread([this] { flushPeriodically(); });
+    }
+
+    ~BufferedFile() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        flusherWakeup.notify_one();
+        if (flusher.joinable()) flusher.join();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            flushLocked();
+            close();
+            removeExpired(expired);
+        }
+        if (archiver.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock(archiveMutex);
+                archiveStopping = true;
+            }
+            archiveWakeup.notify_one();
+            archiver.join(); //дожимает только текущий файл, не всю очередь
+        }
+    }
+
+    BufferedFile(const BufferedFile&) = delete;
+    BufferedFile& operator=(const BufferedFile&) = delete;
+
+    void write(const char* prefix, const std::string& text) {
+        std::lock_guard<std::mutex> lock(mutex);
+        reopenIfNeeded();
+        buffer += prefix;
+        buffer += text;
+        buffer += '\n';
+        if (buffer.size() >= policy.bufferSize || (policy.immediate && policy.immediate->match(text))) flushLocked();
+        rotateIfNeeded();
+    }
+
+    //пачка записей: если буфер переполнится или есть срочная запись - накопленное и вся пачка уходят одним writev,
+    //строки записей не копируются
+    void writeBatch(const char* prefix, RecordSpan records) {
+        std::lock_guard<std::mutex> lock(mutex);
+        reopenIfNeeded();
+        size_t prefixSize = std::strlen(prefix);
+        size_t bytes = buffer.size();
+        bool urgent = false;
+        for (const Record& record : records) {
+            bytes += prefixSize + record.formatted().size() + 1;
+            urgent = urgent || (policy.immediate && policy.immediate->matchRecord(record));
+        }
+        if (!urgent && bytes < policy.bufferSize) {
+            for (const Record& record : records) {
+                buffer += prefix;
+                buffer += record.formatted();
+                buffer += '\n';
+            }
+            rotateIfNeeded();
+            return;
+        }
+#ifndef _WIN32
+        if (!file) open();
+        if (!file) {
+            lost.fetch_add(bytes, std::memory_order_relaxed); //и накопленное, и пачка
+            buffer.clear();
+            return;
+        }
+        std::vector<iovec> parts;
+        parts.reserve(1 + records.size() * 3);
+        if (!buffer.empty()) addPart(parts, buffer.data(), buffer.size());
+        for (const Record& record : records) {
+            addPart(parts, prefix, prefixSize);
+            addPart(parts, record.formatted().data(), record.formatted().size());
+            addPart(parts, "\n", 1);
+        }
+        size_t unwritten = writeAll(fileno(file), parts);
+        lost.fetch_add(unwritten, std::memory_order_relaxed);
+        fileBytes += bytes - unwritten;
+        buffer.clear();
+#else
+        for (const Record& record : records) {
+            buffer += prefix;
+            buffer += record.formatted();
+            buffer += '\n';
+        }
+        flushLocked();
+#endif
+        rotateIfNeeded();
+    }
+
+    void flush() {
+        std::lock_guard<std::mutex> lock(mutex);
+        flushLocked();
+    }
+
+    size_t rotationCount() const { return rotations.load(std::memory_order_relaxed); }
+    size_t lostBytes() const { return lost.load(std::memory_order_relaxed); }
+    size_t archivedCount() const { return archived.load(); }
+    //фоновому потоку больше нечего сжимать
+    bool archiveIdle() const {
+        std::lock_guard<std::mutex> lock(archiveMutex);
+        return archiveQueue.empty() && compressing.empty();
+    }
+    double archiveMillis() const { return archiveNanos.load() / 1e6; } //сколько всего фоновый поток сжимал
+
+    //все файлы переоткроются при следующей записи (например, после logrotate)
+    static void requestReopen() { reopenRequests.fetch_add(1, std::memory_order_relaxed); }
+
+    static void installSighupHandler() {
+#ifndef _WIN32
+        std::signal(SIGHUP, [](int) { requestReopen(); });
+#endif
+    }
+};
+
+std::atomic<unsigned> BufferedFile::reopenRequests{0};
+
+class FileHandler : public ILogHandler {
+    mutable BufferedFile file;
+public:
+    FileHandler(const std::string& path, const FlushPolicy& policy = FlushPolicy(), const RotationPolicy& rotation = RotationPolicy())
+        : file(path, policy, rotation) {}
+
+    void handle(const std::string& text) const override {
+        file.write("FileHandler: ", text);
+    }
+
+    void handleRecord(const Record& record) const override { file.writeBatch("FileHandler: ", RecordSpan(&record, 1)); }
+    void handleBatch(RecordSpan records) const override { file.writeBatch("FileHandler: ", records); }
+
+    void flush() const { file.flush(); }
+    const BufferedFile& output() const { return file; }
+};
+
+class SyslogHandler : public ILogHandler {
+    mutable BufferedFile syslog;
+public:
+    SyslogHandler(const std::string& filename = "system_log.txt", const FlushPolicy& policy = FlushPolicy(),
+                  const RotationPolicy& rotation = RotationPolicy())
+        : syslog(filename, policy, rotation) {}
+
+    void handle(const std::string& text) const override {
+        syslog.write("SyslogHandler: ", text);
+    }
+
+    void handleRecord(const Record& record) const override { syslog.writeBatch("SyslogHandler: ", RecordSpan(&record, 1)); }
+    void handleBatch(RecordSpan records) const override { syslog.writeBatch("SyslogHandler: ", records); }
+
+    void flush() const { syslog.flush(); }
+    const BufferedFile& output() const { return syslog; }
+};
+
+//принимает списки фильтров и списки обработчиков
+class Logger {
+public:
+    //замеры фильтра в порядке регистрации
+    struct FilterCounters {
+        ILogFilter* filter;
+        uint64_t samples;     //сколько раз замерен
+        uint64_t matches;     //из них совпал
+        double nanosPerCall;
+    };
+
+private:
+    std::vector<ILogFilter*> filters;  
+    std::vector<ILogHandler*> handlers;
+
+    //адаптивный порядок: на каждом SAMPLE_EVERY-м сообщении замеряются все фильтры, фоновый поток по замерам
+    //переставляет их (дешевые и часто совпадающие - вперед) и публикует новый порядок без блокировок
+    struct FilterStats {
+        std::atomic<uint64_t> samples{0}, matches{0}, nanos{0};
+    };
+    static constexpr unsigned SAMPLE_EVERY = 64;
+    static constexpr size_t MAX_ORDERS = 16;
+
+    std::unique_ptr<FilterStats[]> stats;
+    std::atomic<unsigned> tick{0};     //номер сообщения для выборки замеров - свой у каждого логгера
+    //опубликованные порядки: log читает их без блокировок, поэтому они живут до конца логгера, но их не больше MAX_ORDERS
+    std::vector<std::unique_ptr<const std::vector<ILogFilter*>>> orders;
+    std::atomic<const std::vector<ILogFilter*>*> order{nullptr};
+    std::atomic<bool> adaptive{false};
+    std::atomic<size_t> reorders{0};
+    std::thread reorderer;
+    std::mutex reorderMutex;
+    std::condition_variable reorderWakeup;
+    bool stopping = false;
+
+    std::atomic<LogLevel> minLevel{LogLevel::TRACE};
+
+    //строка и запись идут одним путем, отличаются только вызовы фильтра и обработчика
+    static bool test(const ILogFilter* filter, const std::string& text) { return filter->match(text); }
+    static bool test(const ILogFilter* filter, const Record& record) { return filter->matchRecord(record); }
+    static void deliver(const ILogHandler* handler, const std::string& text) { handler->handle(text); }
+    static void deliver(const ILogHandler* handler, const Record& record) { handler->handleRecord(record); }
+
+    template<typename Message>
+    void dispatch(const Message& message) {
+        for (ILogHandler* handler : handlers) {
+            deliver(handler, message);
+        }
+    }
+
+    //если хотя бы один фильтр нужно логировать, то логируем по всем обработчикам 
+    template<typename Message>
+    bool accepts(const Message& message) {
+        if (adaptive.load(std::memory_order_relaxed)) {
+            if (tick.fetch_add(1, std::memory_order_relaxed) % SAMPLE_EVERY == SAMPLE_EVERY - 1) return acceptsSampled(message);
+        }
+        for (ILogFilter* filter : *order.load(std::memory_order_acquire)) {
+            if (test(filter, message)) return true;
+        }
+        return false;
+    }
+
+    template<typename Message>
+    void route(const Message& message) {
+        if (accepts(message)) dispatch(message);
+    }
+
+    //простые строки уровнем не ограничиваются
+    bool admitted(const Record& record) const { return record.plain || enabled(record.level); }
+
+    void dispatchBatch(RecordSpan records) {
+        for (ILogHandler* handler : handlers) {
+            handler->handleBatch(records);
+        }
+    }
+
+    //замер: все фильтры по порядку регистрации, иначе поздние видели бы только отвергнутое ранними
+    template<typename Message>
+    bool acceptsSampled(const Message& message) {
+        bool matched = false;
+        for (size_t i = 0; i < filters.size(); i++) {
+            auto start = std::chrono::steady_clock::now();
+            bool match = test(filters[i], message);
+            auto nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+            stats[i].samples.fetch_add(1, std::memory_order_relaxed);
+            stats[i].matches.fetch_add(match, std::memory_order_relaxed);
+            stats[i].nanos.fetch_add(static_cast<uint64_t>(nanos), std::memory_order_relaxed);
+            matched = matched || match;
+        }
+        return matched;
+    }
+
+    //ожидаемая стоимость проверки до первого совпадения, если фильтры независимы
+    static double expectedCost(const std::vector<size_t>& permutation, const std::vector<double>& cost, const std::vector<double>& rate) {
+        double total = 0, reach = 1;
+        for (size_t i : permutation) {
+            total += reach * cost[i];
+            reach *= 1 - rate[i];
+        }
+        return total;
+    }
+
+    void reorderLoop(std::chrono::milliseconds interval) {
+        std::unique_lock<std::mutex> lock(reorderMutex);
+        while (!stopping) {
+            reorderWakeup.wait_for(lock, interval);
+            if (!stopping) reorderLocked();
+        }
+    }
+
+    std::vector<size_t> positions(const std::vector<ILogFilter*>& sequence) const {
+        std::vector<size_t> result;
+        for (ILogFilter* filter : sequence) result.push_back(std::find(filters.begin(), filters.end(), filter) - filters.begin());
+        return result;
+    }
+
+    void reorderLocked() {
+        size_t count = filters.size();
+        std::vector<double> cost(count), rate(count);
+        for (size_t i = 0; i < count; i++) {
+            uint64_t samples = stats[i].samples.load(std::memory_order_relaxed);
+            if (samples < SAMPLE_EVERY) return; //мало данных
+            cost[i] = static_cast<double>(stats[i].nanos.load(std::memory_order_relaxed)) / samples;
+            rate[i] = static_cast<double>(stats[i].matches.load(std::memory_order_relaxed)) / samples;
+        }
+        std::vector<size_t> current = positions(*order.load(std::memory_order_acquire)), best(count);
+        for (size_t i = 0; i < count; i++) best[i] = i;
+        std::stable_sort(best.begin(), best.end(), [&](size_t a, size_t b) {
+            //cost / rate, но без деления на ноль: никогда не совпадающие - в конец, между собой по стоимости
+            if ((rate[a] > 0) != (rate[b] > 0)) return rate[a] > 0;
+            if (rate[a] == 0) return cost[a] < cost[b];
+            return cost[a] * rate[b] < cost[b] * rate[a];
+        });
+        for (size_t i = 0; i < count; i++) {
+            uint64_t samples = stats[i].samples.load(std::memory_order_relaxed);
+            stats[i].samples.fetch_sub(samples / 2, std::memory_order_relaxed);
+            stats[i].matches.fetch_sub(stats[i].matches.load(std::memory_order_relaxed) / 2, std::memory_order_relaxed);
+            stats[i].nanos.fetch_sub(stats[i].nanos.load(std::memory_order_relaxed) / 2, std::memory_order_relaxed);
+        }
+        if (best == current || expectedCost(best, cost, rate) > 0.95 * expectedCost(current, cost, rate)) return;
+
+        std::vector<ILogFilter*> next;
+        for (size_t i : best) next.push_back(filters[i]);
+        //старый порядок может еще читать log в другом потоке, поэтому порядки не удаляются; одинаковые не дублируем
+        const std::vector<ILogFilter*>* chosen = nullptr;
+        for (const auto& published : orders) {
+            if (*published == next) chosen = published.get();
+        }
+        if (!chosen && orders.size() < MAX_ORDERS) {
+            orders.emplace_back(new std::vector<ILogFilter*>(std::move(next)));
+            chosen = orders.back().get();
+        }
+        if (!chosen) {
+            //места нет: берем самый дешевый из уже опубликованных, если он заметно лучше текущего
+            double chosenCost = 0.95 * expectedCost(current, cost, rate);
+            for (const auto& published : orders) {
+                double publishedCost = expectedCost(positions(*published), cost, rate);
+                if (publishedCost < chosenCost) {
+                    chosen = published.get();
+                    chosenCost = publishedCost;
+                }
+            }
+            if (!chosen) return;
+        }
+        order.store(chosen, std::memory_order_release);
+        reorders.fetch_add(1, std::memory_order_relaxed);
+    }
+
+public:
+    Logger(std::vector<ILogFilter*> filters, std::vector<ILogHandler*> handlers)
+        : filters(filters), handlers(handlers), stats(new FilterStats[filters.size()]) {
+        orders.emplace_back(new std::vector<ILogFilter*>(filters));
+        order.store(orders.back().get());
+    }
+
+    ~Logger() {
+        {
+            std::lock_guard<std::mutex> lock(reorderMutex);
+            stopping = true;
+        }
+        reorderWakeup.notify_one();
+        if (reorderer.joinable()) reorderer.join();
+    }
+
+    Logger(const Logger&) = delete;
+    Logger& operator=(const Logger&) = delete;
+
+    //простая строка: уровня нет, проверку уровня не проходит
+    void log(const std::string& text) {
+        route(text);
+    }
+
+    void log(const Record& record) {
+        if (admitted(record)) route(record);
+    }
+
+    //пачка: подряд идущие пропущенные фильтрами записи уходят обработчикам одним handleBatch, без копирования
+    void logBatch(RecordSpan records) {
+        size_t runStart = 0, runLength = 0;
+        for (size_t i = 0; i < records.size(); i++) {
+            if (admitted(records[i]) && accepts(records[i])) {
+                if (runLength == 0) runStart = i;
+                runLength++;
+            } else if (runLength > 0) {
+                dispatchBatch(records.subspan(runStart, runLength));
+                runLength = 0;
+            }
+        }
+        if (runLength > 0) dispatchBatch(records.subspan(runStart, runLength));
+    }
+
+    //проверка уровня во время работы - одно сравнение; LOG_* делают ее до того, как вычислить аргументы
+    bool enabled(LogLevel level) const { return level >= minLevel.load(std::memory_order_relaxed); }
+    void setLevel(LogLevel level) { minLevel.store(level, std::memory_order_relaxed); }
+
+    //включает замеры и фоновую перестановку фильтров раз в interval
+    void adaptFilterOrder(std::chrono::milliseconds interval = std::chrono::milliseconds(500)) {
+        if (adaptive.exchange(true)) return;
+        reorderer = std::thread([this, interval] { reorderLoop(interval); });
+    }
+
+    //пересчитывает порядок по замерам: по возрастанию стоимость / вероятность совпадения.
+    //Новый порядок публикуется, если дешевле текущего хотя бы на 5%. Замеры после этого стареют вдвое
+    void reorder() {
+        std::lock_guard<std::mutex> lock(reorderMutex);
+        reorderLocked();
+    }
+
+    std::vector<FilterCounters> counters() const {
+        std::vector<FilterCounters> result;
+        for (size_t i = 0; i < filters.size(); i++) {
+            uint64_t samples = stats[i].samples.load(std::memory_order_relaxed);
+            result.push_back({filters[i], samples, stats[i].matches.load(std::memory_order_relaxed),
+                              samples ? static_cast<double>(stats[i].nanos.load(std::memory_order_relaxed)) / samples : 0.0});
+        }
+        return result;
+    }
+
+    std::vector<ILogFilter*> filterOrder() const { return *order.load(std::memory_order_acquire); }
+    size_t reorderCount() const { return reorders.load(std::memory_order_relaxed); }
+};
+
+//уровни ниже LOG_MIN_LEVEL вырезаются при компиляции: -DLOG_MIN_LEVEL=2 оставит INFO и выше
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL 0
+#endif
+
+constexpr bool compiledIn(LogLevel level) { return level >= static_cast<LogLevel>(LOG_MIN_LEVEL); }
+
+//аргументы (сообщение и поля) вычисляются, только если уровень включен:
+//LOG_INFO(logger, "user logged in", {{"user", name}, {"attempt", 3}});
+#define LOG_AT(logger, level, ...) \
+    do { \
+        if (compiledIn(level) && (logger).enabled(level)) \
+            (logger).log(Record(level, LOG_HERE, __VA_ARGS__)); \
+    } while (0)
+
+#define LOG_TRACE(logger, ...) LOG_AT(logger, LogLevel::TRACE, __VA_ARGS__)
+#define LOG_DEBUG(logger, ...) LOG_AT(logger, LogLevel::DEBUG, __VA_ARGS__)
+#define LOG_INFO(logger, ...) LOG_AT(logger, LogLevel::INFO, __VA_ARGS__)
+#define LOG_WARNING(logger, ...) LOG_AT(logger, LogLevel::WARNING, __VA_ARGS__)
+#define LOG_ERROR(logger, ...) LOG_AT(logger, LogLevel::ERROR, __VA_ARGS__)
+#define LOG_FATAL(logger, ...) LOG_AT(logger, LogLevel::FATAL, __VA_ARGS__)
+
+//асинхронный режим: log только кладет сообщение в очередь, фильтры и обработчики обернутого Logger
+//выполняют фоновые потоки пачками (Logger::logBatch). Logger агрегируется и должен жить дольше AsyncLogger
+class AsyncLogger {
+public:
+    using Overflow = ::Overflow;
+
+private:
+    Logger& logger;
+    LogRingBuffer<Record> queue;
+    Overflow overflow;
+    std::vector<std::thread> consumers;
+    std::atomic<bool> stopping{false};   //новые сообщения пишутся синхронно
+    std::atomic<bool> draining{false};   //производителей в очереди не осталось, потребители дочитывают и выходят
+    std::atomic<int> inFlight{0};        //производители между проверкой stopping и записью в очередь
+    std::atomic<int> idle{0};            //потребители, которые спят на wakeup
+    std::atomic<size_t> dropped{0};
+    std::mutex idleMutex;
+    std::condition_variable wakeup;
+    std::mutex dispatchMutex;            //обработчики не потокобезопасны: пачки отдаются в logger по одной
+
+    static constexpr size_t BATCH = 256;
+
+    void dispatch(RecordSpan records) {
+        std::lock_guard<std::mutex> lock(dispatchMutex);
+        logger.logBatch(records);
+    }
+
+    void dispatch(const Record& record) {
+        std::lock_guard<std::mutex> lock(dispatchMutex);
+        logger.log(record);
+    }
+
+    void consume() {
+        std::vector<Record> batch;
+        batch.reserve(BATCH);
+        for (;;) {
+            batch.clear();
+            if (queue.popBatch(batch, BATCH) > 0) {
+                dispatch(batch);
+                continue;
+            }
+            if (draining.load()) {
+                return; //очередь пуста и новых сообщений не будет
+            }
+            //пусто: засыпаем; если пробуждение потерялось, wait_for все равно вернется через 1 мс
+            idle.fetch_add(1);
+            {
+                std::unique_lock<std::mutex> lock(idleMutex);
+                wakeup.wait_for(lock, std::chrono::milliseconds(1));
+            }
+            idle.fetch_sub(1);
+        }
+    }
+
+public:
+    AsyncLogger(Logger& logger, size_t capacity = 1 << 16, int consumerCount = 1, Overflow overflow = Overflow::BLOCK)
+        : logger(logger), queue(capacity), overflow(overflow) {
+        for (int i = 0; i < std::max(1, consumerCount); i++) consumers.emplace_back([this] { consume(); });
+    }
+
+    ~AsyncLogger() { shutdown(); }
+
+    AsyncLogger(const AsyncLogger&) = delete;
+    AsyncLogger& operator=(const AsyncLogger&) = delete;
+
+    void log(std::string text) {
+        log(Record(std::move(text)));
+    }
+
+    void log(Record record) {
+        inFlight.fetch_add(1);
+        if (stopping.load()) { //после shutdown ничего не теряем - пишем сразу
+            inFlight.fetch_sub(1);
+            dispatch(record);
+            return;
+        }
+        for (int attempt = 0; !queue.tryPush(record); attempt++) {
+            if (overflow == Overflow::DROP) {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                inFlight.fetch_sub(1);
+                return;
+            }
+            //BLOCK: ждем, пока потребители освободят место; сначала несколько yield, потом короткий сон, чтобы не жечь ядро
+            if (attempt < 16) std::this_thread::yield();
+            else std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+        inFlight.fetch_sub(1);
+        if (idle.load() > 0) wakeup.notify_one();
+    }
+
+    //дописывает все, что уже в очереди, и останавливает потоки; повторный вызов ничего не делает
+    void shutdown() {
+        if (stopping.exchange(true)) return;
+        while (inFlight.load() > 0) std::this_thread::yield();
+        draining.store(true);
+        wakeup.notify_all();
+        for (std::thread& consumer : consumers) consumer.join();
+        Record record;
+        while (queue.tryPop(record)) dispatch(record); //на случай, если потребителей не было
+    }
+
+    size_t droppedCount() const { return dropped.load(std::memory_order_relaxed); }
+};
+
+//обработчик для бенчмарков: только считает сообщения
+class CountingHandler : public ILogHandler {
+    mutable std::atomic<size_t> count{0};
+public:
+    void handle(const std::string&) const override { count.fetch_add(1, std::memory_order_relaxed); }
+    size_t handled() const { return count.load(std::memory_order_relaxed); }
+};
+
+//задержка log на стороне производителя: 1..64 потоков пишут в AsyncLogger, для сравнения - синхронный Logger
+int benchAsync(int messagesPerThread) {
+    SimpleLogFilter filter("error");
+    auto percentile = [](std::vector<uint32_t>& ns, double q) {
+        return ns.empty() ? 0u : ns[static_cast<size_t>(q * (ns.size() - 1))];
+    };
+    auto measure = [&](int threads, auto&& logOne) {
+        std::vector<std::vector<uint32_t>> perThread(threads);
+        std::vector<std::thread> producers;
+        auto start = std::chrono::steady_clock::now();
+        for (int t = 0; t < threads; t++) {
+            producers.emplace_back([&, t] {
+                std::vector<uint32_t>& ns = perThread[t];
+                ns.reserve(messagesPerThread);
+                std::string text = "request " + std::to_string(t) + " failed with error, retrying";
+                for (int i = 0; i < messagesPerThread; i++) {
+                    auto t0 = std::chrono::steady_clock::now();
+                    logOne(text);
+                    auto t1 = std::chrono::steady_clock::now();
+                    ns.push_back(static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count()));
+                }
+            });
+        }
+        for (std::thread& producer : producers) producer.join();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::vector<uint32_t> all;
+        for (auto& ns : perThread) all.insert(all.end(), ns.begin(), ns.end());
+        std::sort(all.begin(), all.end());
+        std::cout << "p50 " << percentile(all, 0.5) << " ns, p99 " << percentile(all, 0.99) << " ns, p99.9 "
+                  << percentile(all, 0.999) << " ns, max " << (all.empty() ? 0u : all.back()) << " ns, "
+                  << static_cast<size_t>(all.size() / seconds) << " msgs/s";
+    };
+
+    {
+        FileHandler file("bench_sync.log");
+        Logger sync({&filter}, {&file});
+        std::cout << "sync Logger + FileHandler,   1 producer:  ";
+        measure(1, [&](const std::string& text) { sync.log(text); });
+        std::cout << "\n";
+        std::remove("bench_sync.log");
+    }
+    for (int threads : {1, 2, 4, 8, 16, 32, 64}) {
+        CountingHandler counter;
+        Logger logger({&filter}, {&counter});
+        size_t handled;
+        {
+            AsyncLogger async(logger, 1 << 16);
+            std::cout << "AsyncLogger + CountingHandler, " << threads << " producers: ";
+            measure(threads, [&](const std::string& text) { async.log(text); });
+            async.shutdown();
+            handled = counter.handled();
+        }
+        std::cout << ", handled " << handled << "/" << static_cast<size_t>(threads) * messagesPerThread << "\n";
+    }
+    return 0;
+}
+
+//сообщений в секунду: старый FileHandler (open/write/close на строку) против буферизованного
+int benchFile(int messages) {
+    const char* path = "bench_file.log";
+    std::string text = "request 42 failed with error, retrying";
+    auto run = [&](const char* name, auto&& writeAll) {
+        std::remove(path);
+        auto start = std::chrono::steady_clock::now();
+        writeAll();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << name << static_cast<size_t>(messages / seconds) << " msgs/s\n";
+    };
+
+    run("open/write/close per message:   ", [&] {
+        for (int i = 0; i < messages; i++) {
+            std::ofstream fout;
+            fout.open(path, std::ios_base::app);
+            fout << "FileHandler: " << text << std::endl;
+            fout.close();
+        }
+    });
+    SimpleLogFilter everything("");
+    FlushPolicy immediate;
+    immediate.immediate = &everything;
+    run("open once, flush every message: ", [&] {
+        FileHandler handler(path, immediate);
+        for (int i = 0; i < messages; i++) handler.handle(text);
+    });
+    run("buffered 64 KiB, 1 s interval:  ", [&] {
+        FileHandler handler(path);
+        for (int i = 0; i < messages; i++) handler.handle(text);
+    });
+    std::remove(path);
+    return 0;
+}
+
+//случайные строки из строчных латинских букв длиной от minLength до maxLength
+std::vector<std::string> randomWords(size_t count, size_t minLength, size_t maxLength, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<size_t> length(minLength, maxLength);
+    std::uniform_int_distribution<int> letter('a', 'z');
+    std::vector<std::string> words(count);
+    for (std::string& word : words) {
+        word.resize(length(rng));
+        for (char& c : word) c = static_cast<char>(letter(rng));
+    }
+    return words;
+}
+
+//MultiPatternLogFilter против цепочки SimpleLogFilter (как Logger::log: до первого совпадения)
+int benchPatterns(int messages) {
+    std::vector<std::string> lines;
+    std::vector<std::string> words = randomWords(200, 3, 9, 7);
+    std::mt19937 rng(11);
+    for (int i = 0; i < 1000; i++) {
+        std::string line = "2024-05-01 12:00:" + std::to_string(10 + i % 50) + " [worker-" + std::to_string(i % 16) + "]";
+        while (line.size() < 120) line += " " + words[rng() % words.size()];
+        lines.push_back(line);
+    }
+    size_t bytes = 0;
+    for (int i = 0; i < messages; i++) bytes += lines[i % lines.size()].size();
+
+    for (size_t count : {10, 100, 1000}) {
+        std::vector<std::string> patterns = randomWords(count, 6, 12, 3);
+        patterns.back() = "disk full"; //одно совпадение на ~1% строк
+        for (size_t i = 0; i < lines.size(); i += 100) lines[i] += " disk full";
+
+        std::vector<SimpleLogFilter> simple;
+        for (const std::string& pattern : patterns) simple.emplace_back(pattern);
+        MultiPatternLogFilter multi(patterns);
+
+        auto run = [&](auto&& matchOne) {
+            size_t matched = 0;
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < messages; i++) matched += matchOne(lines[i % lines.size()]);
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            std::cout << static_cast<int>(seconds * 1e9 / messages) << " ns/msg, " << static_cast<int>(bytes / seconds / 1e6)
+                      << " MB/s, matched " << matched;
+        };
+        std::cout << count << " patterns: SimpleLogFilter chain ";
+        run([&](const std::string& text) {
+            for (const SimpleLogFilter& filter : simple) if (filter.match(text)) return 1;
+            return 0;
+        });
+        std::cout << " | MultiPatternLogFilter (" << multi.stateCount() << " states) ";
+        run([&](const std::string& text) { return multi.match(text) ? 1 : 0; });
+        std::cout << "\n";
+        for (size_t i = 0; i < lines.size(); i += 100) lines[i].resize(lines[i].size() - 10);
+    }
+    return 0;
+}
+
+//МБ/с: ReLogFilter с ленивым ДКА против std::regex_search на строках, похожих на журнал
+int benchRegex(int messages) {
+    std::vector<std::string> lines;
+    std::vector<std::string> words = randomWords(100, 3, 9, 5);
+    const char* levels[] = {"INFO", "DEBUG", "WARN", "ERROR"};
+    std::mt19937 rng(13);
+    for (int i = 0; i < 1000; i++) {
+        std::string line = "2024-05-01 12:" + std::to_string(10 + i % 50) + ":" + std::to_string(10 + i % 49) + " [worker-"
+                           + std::to_string(i % 16) + "] " + levels[rng() % 4];
+        if (i % 10 == 0) line += " user=" + words[rng() % words.size()] + "@example.com";
+        if (i % 25 == 0) line += " timeout after " + std::to_string(rng() % 5000) + " ms";
+        while (line.size() < 120) line += " " + words[rng() % words.size()];
+        lines.push_back(line);
+    }
+    size_t bytes = 0;
+    for (int i = 0; i < messages; i++) bytes += lines[i % lines.size()].size();
+
+    for (const char* pattern : {"[0-9]+", "ERROR|WARN(ING)?", "user=[a-z]+@[a-z]+\\.com", "timeout after [0-9]+ ?ms",
+                                "^2024-05-01 12:[0-9]{2}:[0-9]{2} \\[worker-1[0-5]\\]", "disk (full|quota) on /dev/[a-z]+[0-9]"}) {
+        std::regex re(pattern);
+        ReLogFilter filter{std::string(pattern)};
+        auto run = [&](auto&& matchOne) {
+            size_t matched = 0;
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < messages; i++) matched += matchOne(lines[i % lines.size()]);
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            std::cout << static_cast<int>(bytes / seconds / 1e6) << " MB/s (" << matched << ")";
+        };
+        std::cout << pattern << ": std::regex ";
+        run([&](const std::string& text) { return std::regex_search(text, re) ? 1 : 0; });
+        std::cout << " | ReLogFilter" << (filter.compiled() ? "" : " [std::regex]") << " ";
+        run([&](const std::string& text) { return filter.match(text) ? 1 : 0; });
+        std::cout << "\n";
+    }
+
+    //у a[ab]{12}c ~8000 состояний ДКА - больше MAX_STATES: случайные строки в 4 потока переполняют кэш, ответы сверяются с std::regex.
+    //Потом одни и те же новые строки: после сброса кэш снова набирается, и поиск опять идет по готовым переходам
+    const char* wide = "a[ab]{12}c";
+    std::regex re(wide);
+    std::shared_ptr<const RegexDfa> dfa = RegexDfa::compile(wide);
+    auto noise = [&](size_t count) {
+        std::vector<std::string> result(count);
+        for (std::string& line : result) {
+            while (line.size() < 120) line += "abc"[rng() % 50 == 0 ? 2 : rng() % 2];
+        }
+        return result;
+    };
+    std::vector<std::string> random = noise(8000);
+    std::atomic<int> mismatches{0};
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < 4; t++) {
+        threads.emplace_back([&, t] {
+            for (size_t i = t; i < random.size(); i += 4) {
+                if (dfa->search(random[i]) != std::regex_search(random[i], re)) mismatches.fetch_add(1);
+            }
+        });
+    }
+    for (std::thread& thread : threads) thread.join();
+    size_t flushes = dfa->flushCount();
+    std::vector<std::string> repeated = noise(16);
+    for (const std::string& line : repeated) dfa->search(line);
+    size_t warm = dfa->flushCount();
+    size_t matched = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < messages; i++) matched += dfa->search(repeated[i % repeated.size()]);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << wide << ": " << flushes << " cache flushes on 8000 random lines, " << mismatches << " mismatches; 16 repeated lines "
+              << static_cast<int>(120.0 * messages / seconds / 1e6) << " MB/s (" << matched << "), "
+              << dfa->flushCount() - warm << " flushes after warm-up\n";
+    return mismatches == 0 && dfa->flushCount() == warm ? 0 : 1;
+}
+
+//перестановка фильтров: дорогой редкий фильтр зарегистрирован первым, дешевый частый - последним
+int benchOrder(int messages) {
+    std::vector<std::string> lines;
+    std::vector<std::string> words = randomWords(100, 3, 9, 9);
+    std::mt19937 rng(17);
+    for (int i = 0; i < 1009; i++) { //простое число строк, чтобы каждое 64-е сообщение не попадало в одни и те же
+        int kind = static_cast<int>(rng() % 100);
+        std::string line = kind < 70 ? "INFO" : kind < 90 ? "DEBUG" : kind < 99 ? "WARN disk quota" : "ERROR timeout after 300 ms";
+        while (line.size() < 120) line += " " + words[rng() % words.size()];
+        lines.push_back(line);
+    }
+
+    ReLogFilter timeout(std::regex("timeout after [0-9]+ ms"));   //std::regex - самый дорогой
+    MultiPatternLogFilter quota({"disk quota", "disk full", "no space left"});
+    SimpleLogFilter info("INFO");
+    auto run = [&](Logger& logger, const char* name) {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < messages; i++) logger.log(lines[i % lines.size()]);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << name << static_cast<int>(seconds * 1e9 / messages) << " ns/msg\n";
+    };
+
+    CountingHandler fixedCounter, adaptiveCounter;
+    Logger fixed({&timeout, &quota, &info}, {&fixedCounter});
+    run(fixed, "registration order: ");
+
+    Logger adaptive({&timeout, &quota, &info}, {&adaptiveCounter});
+    adaptive.adaptFilterOrder(std::chrono::milliseconds(20));
+    run(adaptive, "adaptive (warm-up):  ");
+    run(adaptive, "adaptive:            ");
+    std::cout << "handled " << fixedCounter.handled() << " / " << adaptiveCounter.handled() / 2 << ", reorders " << adaptive.reorderCount() << "\n";
+    const char* names[] = {"timeout regex", "quota multi", "INFO simple"};
+    ILogFilter* all[] = {&timeout, &quota, &info};
+    std::cout << "order:";
+    for (ILogFilter* filter : adaptive.filterOrder()) std::cout << " " << names[std::find(all, all + 3, filter) - all];
+    std::cout << "\n";
+    for (const Logger::FilterCounters& counters : adaptive.counters()) {
+        std::cout << "  " << names[std::find(all, all + 3, counters.filter) - all] << ": samples " << counters.samples << ", matches "
+                  << counters.matches << ", " << static_cast<int>(counters.nanosPerCall) << " ns/call\n";
+    }
+    return 0;
+}
+
+//стоимость сообщения, которое в итоге не пишется: строка против записи с проверкой уровня
+int benchFiltered(int messages) {
+    std::string name = "alice";
+    SimpleLogFilter text("disk full");
+    FieldFilter field(Field("user", "mallory"));
+    LevelFilter errors(LogLevel::ERROR);
+    CountingHandler counter;
+    Logger logger({&text}, {&counter});
+    Logger structured({&field, &errors}, {&counter});
+    logger.setLevel(LogLevel::INFO);
+    structured.setLevel(LogLevel::INFO);
+
+    auto run = [&](const char* label, auto&& logOne) {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < messages; i++) logOne(i);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << label << seconds * 1e9 / messages << " ns/msg\n";
+    };
+    run("log(string), no filter matches:         ", [&](int i) {
+        logger.log("user " + name + " logged in, attempt " + std::to_string(i));
+    });
+    run("LOG_DEBUG, level disabled at runtime:   ", [&](int i) {
+        LOG_DEBUG(logger, "user logged in", {{"user", name}, {"attempt", i}});
+    });
+    run("LOG_INFO, field and level filters:      ", [&](int i) {
+        LOG_INFO(structured, "user logged in", {{"user", name}, {"attempt", i}});
+    });
+    run("LOG_INFO, text filter (formats text):   ", [&](int i) {
+        LOG_INFO(logger, "user logged in", {{"user", name}, {"attempt", i}});
+    });
+    std::cout << "handled " << counter.handled() << "\n";
+    return 0;
+}
+
+//системные вызовы записи на сообщение: по одной записи, пачками через writev, через AsyncLogger
+int benchBatch(int messages) {
+    const char* path = "bench_batch.log";
+    const size_t BATCH = 64;
+    messages -= messages % BATCH;
+    std::vector<Record> records;
+    for (int i = 0; i < 1024; i++) {
+        records.emplace_back(LogLevel::INFO, LOG_HERE, "request served", std::initializer_list<Field>{{"id", i}, {"status", 200}, {"path", "/api/items"}});
+    }
+    SimpleLogFilter everything("");
+    FlushPolicy immediate;
+    immediate.immediate = &everything; //каждая запись срочная - как старый FileHandler
+
+    auto run = [&](const char* label, auto&& body) {
+        std::remove(path);
+        size_t before = io_stats::writes.load();
+        auto start = std::chrono::steady_clock::now();
+        body();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << label << static_cast<size_t>(messages / seconds) << " msgs/s, "
+                  << static_cast<double>(io_stats::writes.load() - before) / messages << " write syscalls/msg\n";
+    };
+    run("handleRecord, flush every record:   ", [&] {
+        FileHandler handler(path, immediate);
+        for (int i = 0; i < messages; i++) handler.handleRecord(records[i % records.size()]);
+    });
+    run("handleBatch(64), flush every batch: ", [&] {
+        FileHandler handler(path, immediate);
+        for (int i = 0; i < messages; i += BATCH) handler.handleBatch(RecordSpan(&records[i % records.size()], BATCH));
+    });
+    run("handleBatch(64), 64 KiB buffer:     ", [&] {
+        FileHandler handler(path);
+        for (int i = 0; i < messages; i += BATCH) handler.handleBatch(RecordSpan(&records[i % records.size()], BATCH));
+    });
+    run("AsyncLogger -> logBatch, immediate: ", [&] {
+        FileHandler handler(path, immediate);
+        Logger logger({&everything}, {&handler});
+        AsyncLogger async(logger);
+        for (int i = 0; i < messages; i++) async.log(records[i % records.size()]);
+        async.shutdown();
+    });
+    std::remove(path);
+    return 0;
+}
+
+#ifndef _WIN32
+//поток в коллектор через loopback: пропускная способность, задержка handle и доставки, потери у медленного коллектора
+int benchSocket(int messages) {
+    auto percentile = [](std::vector<int64_t>& values, double q) {
+        std::sort(values.begin(), values.end());
+        return values.empty() ? 0 : values[static_cast<size_t>(q * (values.size() - 1))];
+    };
+    auto nowNanos = [] {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    };
+    std::string unixAddress = "unix:/tmp/thirdlab_bench_" + std::to_string(::getpid()) + ".sock";
+
+    for (const std::string& address : {unixAddress, std::string("127.0.0.1:0")}) {
+        for (bool slow : {false, true}) {
+            std::vector<int64_t> delivery, producer;
+            delivery.reserve(messages);
+            producer.reserve(messages);
+            //в сообщении время отправки, коллектор считает задержку доставки
+            LogCollector collector(address, [&](const std::string& message) {
+                size_t at = message.rfind("t=");
+                if (at != std::string::npos) delivery.push_back(nowNanos() - std::atoll(message.c_str() + at + 2));
+            });
+            SocketOptions options;
+            options.queueCapacity = slow ? 4096 : 1 << 16;
+            options.overflow = slow ? Overflow::DROP : Overflow::BLOCK;
+            if (slow) collector.setReadDelay(std::chrono::microseconds(2000));
+            size_t dropped, sent, received;
+            double seconds;
+            {
+                SocketHandler handler(collector.address(), options);
+                auto start = std::chrono::steady_clock::now();
+                for (int i = 0; i < messages; i++) {
+                    int64_t t0 = nowNanos();
+                    handler.handle("request " + std::to_string(i) + " served in 12 ms t=" + std::to_string(t0));
+                    producer.push_back(nowNanos() - t0);
+                }
+                handler.drain(std::chrono::milliseconds(slow ? 2000 : 30000));
+                seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                dropped = handler.connection().droppedCount();
+                sent = handler.connection().sentCount();
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(100)); //коллектор дочитывает
+            received = collector.receivedCount();
+            collector.stop(); //поток коллектора пишет в delivery - останавливаем его до сортировки
+            std::cout << (address == unixAddress ? "unix" : "tcp ") << (slow ? " slow collector, DROP: " : " BLOCK:                 ")
+                      << static_cast<size_t>(sent / seconds) << " msgs/s, handle p50 " << percentile(producer, 0.5) << " ns p99 "
+                      << percentile(producer, 0.99) << " ns, delivery p50 " << percentile(delivery, 0.5) / 1000 << " us p99 "
+                      << percentile(delivery, 0.99) / 1000 << " us, received " << received << "/" << messages << ", dropped by queue " << dropped << "\n";
+        }
+    }
+    return 0;
+}
+#endif
+
+int benchRotate(int messages) {
+    auto percentile = [](std::vector<int64_t> values, double q) {
+        std::sort(values.begin(), values.end());
+        return values.empty() ? 0 : values[static_cast<size_t>(q * (values.size() - 1))];
+    };
+    std::filesystem::path directory = std::filesystem::temp_directory_path() / "thirdlab_rotate";
+    std::vector<std::string> lines;
+    for (int i = 0; i < 1000; i++) {
+        lines.push_back("request " + std::to_string(i * 7919 % 100000) + " from user" + std::to_string(i % 37) + " served in "
+                        + std::to_string(i % 250) + " ms");
+    }
+
+    RotationPolicy none, plain;
+    plain.maxBytes = 4 << 20;
+    plain.keep = 3;
+    plain.compress = false;
+    RotationPolicy packed = plain;
+    packed.compress = true;
+    for (const auto& [name, rotation] : {std::make_pair("no rotation:          ", none),
+                                         std::make_pair("rotation, keep 3:     ", plain),
+                                         std::make_pair("rotation + gzip in bg:", packed)}) {
+        std::filesystem::remove_all(directory);
+        std::filesystem::create_directories(directory);
+        std::vector<int64_t> latency, rotating;
+        latency.reserve(messages);
+        FileHandler handler((directory / "app.log").string(), FlushPolicy(), rotation);
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < messages; i++) {
+            size_t before = handler.output().rotationCount();
+            auto t0 = std::chrono::steady_clock::now();
+            handler.handle(lines[i % lines.size()]);
+            int64_t nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0).count();
+            latency.push_back(nanos);
+            if (handler.output().rotationCount() != before) rotating.push_back(nanos);
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        size_t rotations = handler.output().rotationCount();
+        std::cout << name << " " << static_cast<size_t>(messages / seconds) << " msgs/s, handle p50 " << percentile(latency, 0.5)
+                  << " ns p99 " << percentile(latency, 0.99) << " ns p99.9 " << percentile(latency, 0.999) << " ns max "
+                  << percentile(latency, 1.0) / 1000 << " us; rotations " << rotations << ", slowest rotating call "
+                  << percentile(rotating, 1.0) / 1000 << " us";
+        if (rotation.compress && rotations > 0) {
+            //ждем фоновый поток только ради статистики
+            while (!handler.output().archiveIdle()) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            std::cout << ", gzip in background " << handler.output().archiveMillis() / std::max<size_t>(1, handler.output().archivedCount())
+                      << " ms per file";
+        }
+        std::cout << "\n";
+    }
+    std::filesystem::remove_all(directory);
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    //thirdLab --bench-async [сообщений на поток]
+    if (argc > 1 && std::string(argv[1]) == "--bench-async") {
+        return benchAsync(argc > 2 ? std::atoi(argv[2]) : 20000);
+    }
+    //thirdLab --bench-file [сообщений]
+    if (argc > 1 && std::string(argv[1]) == "--bench-file") {
+        return benchFile(argc > 2 ? std::atoi(argv[2]) : 200000);
+    }
+    //thirdLab --bench-patterns [сообщений]
+    if (argc > 1 && std::string(argv[1]) == "--bench-patterns") {
+        return benchPatterns(argc > 2 ? std::atoi(argv[2]) : 100000);
+    }
+    //thirdLab --bench-regex [сообщений]
+    if (argc > 1 && std::string(argv[1]) == "--bench-regex") {
+        return benchRegex(argc > 2 ? std::atoi(argv[2]) : 100000);
+    }
+    //thirdLab --bench-order [сообщений]
+    if (argc > 1 && std::string(argv[1]) == "--bench-order") {
+        return benchOrder(argc > 2 ? std::atoi(argv[2]) : 500000);
+    }
+    //thirdLab --bench-filtered [сообщений]
+    if (argc > 1 && std::string(argv[1]) == "--bench-filtered") {
+        return benchFiltered(argc > 2 ? std::atoi(argv[2]) : 1000000);
+    }
+    //thirdLab --bench-rotate [сообщений]
+    if (argc > 1 && std::string(argv[1]) == "--bench-rotate") {
+        return benchRotate(argc > 2 ? std::atoi(argv[2]) : 1000000);
+    }
+    //thirdLab --bench-batch [сообщений]
+    if (argc > 1 && std::string(argv[1]) == "--bench-batch") {
+        return benchBatch(argc > 2 ? std::atoi(argv[2]) : 200000);
+    }
+#ifndef _WIN32
+    //thirdLab --bench-socket [сообщений]
+    if (argc > 1 && std::string(argv[1]) == "--bench-socket") {
+        return benchSocket(argc > 2 ? std::atoi(argv[2]) : 200000);
+    }
+    //thirdLab --collector адрес - печатает все, что пришло, до Ctrl+C
+    if (argc > 2 && std::string(argv[1]) == "--collector") {
+        LogCollector collector(argv[2], [](const std::string& message) { std::cout << message << std::endl; });
+        std::cout << "listening on " << collector.address() << std::endl;
+        for (;;) std::this_thread::sleep_for(std::chrono::seconds(1));
+    }
+#endif
+    BufferedFile::installSighupHandler();
+
     SimpleLogFilter error_filter("error");
-    ReLogFilter email_filter(std::regex("[0-9]+"));
+    ReLogFilter email_filter("[0-9]+");
 
     ConsoleHandler console_handler;
     FileHandler file_handler("log.txt");